@@ -1,8 +1,14 @@
 #include "ImageEditorApp.h"
 #include "node-editor/nodes/InputNode.h"
 #include "node-editor/nodes/OutputNode.h"
+#include "node-editor/ImageDataManager.h"
+#include "node-editor/BufferPool.h"
+#include "node-editor/AllocationCounter.h"
+#include <opencv2/core/utils/filesystem.hpp>
 #include <vector>
 #include <string>
+#include <cmath>
+#include <cstdlib>
 
 // Initialize the static instance pointer
 ImageEditorApp* ImageEditorApp::s_Instance = nullptr;
@@ -30,13 +36,34 @@ ImageEditorApp::~ImageEditorApp()
 
 void ImageEditorApp::OnStart()
 {
+    // Image buffers are recycled across evaluations instead of reallocated
+    BufferPool::GetInstance().Install();
+    AllocationCounter::InstallImGuiHooks();
+
     // Initialize the node editor manager
     m_NodeEditor = std::make_unique<NodeEditorManager>();
     m_NodeEditor->Initialize();
 }
 
+std::string ImageEditorApp::GetDiskCacheDirectory()
+{
+    // Per user, never the working directory: %LOCALAPPDATA%, or the temporary directory.
+    // Empty (the cache stays off) if neither is known.
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (!base || !*base)
+        base = std::getenv("TEMP");
+    if (!base || !*base)
+        return std::string();
+    return cv::utils::fs::join(cv::utils::fs::join(base, "node-based-image-processor"), "ResultCache");
+}
+
 void ImageEditorApp::OnFrame(float deltaTime)
 {
+    // What the previous frame allocated, from this call to the last one
+    const uint64_t allocations = AllocationCounter::GetAllocations();
+    m_LastFrameAllocations = allocations - m_FrameStartAllocations;
+    m_FrameStartAllocations = allocations;
+
     // Show main menu bar
     ShowMainMenuBar();
 
@@ -58,6 +85,9 @@ void ImageEditorApp::OnFrame(float deltaTime)
     // Show demo windows if enabled
     if (m_ShowImGuiDemoWindow)
         ImGui::ShowDemoWindow(&m_ShowImGuiDemoWindow);
+
+    if (m_ShowStatisticsWindow)
+        ShowStatisticsWindow();
 }
 
 void ImageEditorApp::OnStop()
@@ -152,6 +182,7 @@ void ImageEditorApp::ShowMainMenuBar()
         if (ImGui::BeginMenu("View"))
         {
             ImGui::MenuItem("ImGui Demo", nullptr, &m_ShowImGuiDemoWindow);
+            ImGui::MenuItem("Statistics", nullptr, &m_ShowStatisticsWindow);
 
             ImGui::EndMenu();
         }
@@ -201,6 +232,164 @@ void ImageEditorApp::ShowPropertiesPanel()
     ImGui::EndChild();
 }
 
+void ImageEditorApp::ShowStatisticsWindow()
+{
+    if (!ImGui::Begin("Statistics", &m_ShowStatisticsWindow))
+    {
+        ImGui::End();
+        return;
+    }
+
+    // Image buffer hand-offs between nodes
+    ImageDataStats stats = ImageDataManager::GetInstance().GetStats();
+    ImGui::Text("Image Data");
+    ImGui::Separator();
+    ImGui::Text("Shared hand-offs (publishes and reads without a clone): %llu (%.1f MB)", (unsigned long long)stats.SharedHandoffs,
+        stats.SharedBytes / (1024.0 * 1024.0));
+    ImGui::Text("Compressed cold images: %d (%.1f MB, %.1f MB uncompressed)", stats.CompressedImages,
+        stats.CompressedBytes / (1024.0 * 1024.0), stats.UncompressedBytes / (1024.0 * 1024.0));
+    ImGui::Text("Decompressions: %llu", (unsigned long long)stats.Decompressions);
+    if (stats.DecompressionFailures > 0)
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Corrupt compressed images (recomputed): %llu", (unsigned long long)stats.DecompressionFailures);
+    if (m_NodeEditor)
+    {
+        int compressAfter = m_NodeEditor->GetCompressAfter();
+        if (ImGui::SliderInt("Compress after idle evaluations (0 = never)", &compressAfter, 0, 20))
+            m_NodeEditor->SetCompressAfter(compressAfter);
+
+        bool halfPrecision = m_NodeEditor->IsHalfPrecisionStorage();
+        if (ImGui::Checkbox("Store float images in half precision", &halfPrecision))
+            m_NodeEditor->SetHalfPrecisionStorage(halfPrecision);
+    }
+    ImGui::Text("Half precision images: %d (%.1f MB saved, %llu kept in single precision)", stats.HalfPrecisionImages,
+        stats.HalfPrecisionBytesSaved / (1024.0 * 1024.0), (unsigned long long)stats.HalfPrecisionRejected);
+    ImGui::Text("Half precision reads: %llu", (unsigned long long)stats.HalfPrecisionDecodes);
+    bool checkPrecision = ImageDataManager::GetInstance().GetHalfPrecisionCheck();
+    if (ImGui::Checkbox("Measure half precision error", &checkPrecision))
+        ImageDataManager::GetInstance().SetHalfPrecisionCheck(checkPrecision);
+    if (checkPrecision)
+    {
+        ImGui::Text("Largest relative error: %.2e (bound %.2e)", stats.MaxHalfPrecisionError,
+            ImageDataManager::HalfPrecisionErrorBound);
+    }
+    if (ImGui::Button("Reset##ImageDataStats"))
+    {
+        ImageDataManager::GetInstance().ResetStats();
+    }
+
+    // Recycled image buffers
+    BufferPool& bufferPool = BufferPool::GetInstance();
+    BufferPoolStats poolStats = bufferPool.GetStats();
+    ImGui::Spacing();
+    ImGui::Text("Buffer Pool");
+    ImGui::Separator();
+    ImGui::Text("Large allocations: %llu (%llu reused, %llu from the system)", (unsigned long long)poolStats.Allocations,
+        (unsigned long long)poolStats.PoolHits, (unsigned long long)poolStats.SystemAllocations);
+    ImGui::Text("In use: %.1f MB, retained: %.1f MB", poolStats.BytesInUse / (1024.0 * 1024.0), poolStats.BytesRetained / (1024.0 * 1024.0));
+    int retainedMB = (int)(bufferPool.GetMaxRetainedBytes() / (1024 * 1024));
+    if (ImGui::SliderInt("Max retained (MB)", &retainedMB, 0, 16384))
+        bufferPool.SetMaxRetainedBytes((size_t)retainedMB * 1024 * 1024);
+    ImGui::Text("Mapped to scratch files: %d (%.1f MB, %llu failed)", poolStats.MappedBuffers,
+        poolStats.MappedBytes / (1024.0 * 1024.0), (unsigned long long)poolStats.MappingFailures);
+    int mappedMB = (int)(bufferPool.GetMappedMinBytes() / (1024 * 1024));
+    if (ImGui::SliderInt("Map images from (MB, 0 = never)", &mappedMB, 0, 16384))
+        bufferPool.SetMappedMinBytes((size_t)mappedMB * 1024 * 1024);
+    if (ImGui::Button("Reset##BufferPoolStats"))
+        bufferPool.ResetStats();
+    ImGui::SameLine();
+    if (ImGui::Button("Release retained buffers"))
+        bufferPool.Trim();
+
+    // Incremental evaluation
+    if (m_NodeEditor)
+    {
+        const EvaluationStats& evalStats = m_NodeEditor->GetEvaluationStats();
+        ImGui::Spacing();
+        ImGui::Text("Evaluation");
+        ImGui::Separator();
+        ImGui::Text("Nodes recomputed by last edit: %d", evalStats.NodesProcessed);
+        ImGui::Text("Nodes skipped by last edit: %d", evalStats.NodesSkipped);
+        ImGui::Text("Dead nodes (no output or visible preview): %d", evalStats.DeadNodes);
+        ImGui::Text("Merged identical nodes: %d", evalStats.MergedNodes);
+        ImGui::Text("Unread outputs skipped: %d", evalStats.SkippedOutputs);
+        ImGui::Text("Evaluations: %llu (%llu node runs)", (unsigned long long)evalStats.Evaluations, (unsigned long long)evalStats.TotalNodesProcessed);
+        ImGui::Text("Last evaluation: %.1f ms%s", evalStats.LastEvaluationMs, m_NodeEditor->IsEvaluating() ? " (evaluating...)" : "");
+        ImGui::Text("Selected and visible nodes shown after: %.1f ms", evalStats.FocusMs);
+        ImGui::Text("Cancelled evaluations: %llu", (unsigned long long)evalStats.CancelledEvaluations);
+        if (AllocationCounter::IsEnabled())
+            ImGui::Text("Heap allocations last frame: %llu (none while idle)", (unsigned long long)m_LastFrameAllocations);
+        int threadCount = (int)m_NodeEditor->GetThreadCount();
+        if (ImGui::SliderInt("Worker threads (shared with OpenCV)", &threadCount, 1, (int)ThreadPool::GetHardwareThreadCount()))
+            m_NodeEditor->SetThreadCount((unsigned)threadCount);
+        bool tiled = m_NodeEditor->IsTiledEvaluation();
+        if (ImGui::Checkbox("Tiled evaluation", &tiled))
+            m_NodeEditor->SetTiledEvaluation(tiled);
+        ImGui::Text("Tiled nodes: %d (%d tiles)", evalStats.TiledNodes, evalStats.Tiles);
+        ImGui::Text("Per tile: %.2f ms average, %.2f ms slowest, %.1f MB/s", evalStats.TileMs, evalStats.SlowestTileMs,
+            evalStats.TileThroughputMBps);
+        bool streaming = m_NodeEditor->IsStreamingEvaluation();
+        if (ImGui::Checkbox("Streaming evaluation (large images)", &streaming))
+            m_NodeEditor->SetStreamingEvaluation(streaming);
+        ImGui::Text("Streamed nodes: %d (line buffers: %.1f KB, whole inputs and outputs: %.1f MB)", evalStats.StreamedNodes,
+            evalStats.LineBufferBytes / 1024.0, evalStats.StreamedImageBytes / (1024.0 * 1024.0));
+        ImGui::Text("Region-only nodes: %d (%lld pixels)", evalStats.RegionNodes, (long long)evalStats.RegionPixels);
+        bool fusion = m_NodeEditor->IsPointwiseFusion();
+        if (ImGui::Checkbox("Fuse pointwise nodes", &fusion))
+            m_NodeEditor->SetPointwiseFusion(fusion);
+        ImGui::Text("Fused nodes: %d (%.1f MB of memory traffic saved)", evalStats.FusedNodes, evalStats.FusionBytesSaved / (1024.0 * 1024.0));
+        const size_t budget = m_NodeEditor->GetMemoryBudget();
+        const double usageMB = m_NodeEditor->GetMemoryUsage() / (1024.0 * 1024.0);
+        if (budget)
+            ImGui::Text("Image memory: %.1f MB of %.0f MB", usageMB, budget / (1024.0 * 1024.0));
+        else
+            ImGui::Text("Image memory: %.1f MB (no budget)", usageMB);
+        int budgetMB = (int)(budget / (1024 * 1024));
+        if (ImGui::SliderInt("Memory budget (MB, 0 = none)", &budgetMB, 0, 65536))
+            m_NodeEditor->SetMemoryBudget((size_t)budgetMB * 1024 * 1024);
+        ImGui::Text("Evicted nodes: %llu (%d recomputed by last edit)", (unsigned long long)evalStats.Evictions, evalStats.RecomputedNodes);
+        ResultCache& resultCache = m_NodeEditor->GetResultCache();
+        ImGui::Text("Result cache: %d hits, %d misses by last edit", evalStats.CacheHits, evalStats.CacheMisses);
+        ImGui::Text("Cached results: %zu (%.1f of %.0f MB)", resultCache.GetEntryCount(),
+            resultCache.GetSizeInBytes() / (1024.0 * 1024.0), resultCache.GetCapacity() / (1024.0 * 1024.0));
+        int cacheMB = (int)(resultCache.GetCapacity() / (1024 * 1024));
+        if (ImGui::SliderInt("Cache size (MB)", &cacheMB, 0, 4096))
+            resultCache.SetCapacity((size_t)cacheMB * 1024 * 1024);
+        if (ImGui::Button("Clear##ResultCache"))
+            resultCache.Clear();
+        DiskResultCache* diskCache = m_NodeEditor->GetDiskCache();
+        bool diskCacheEnabled = diskCache != nullptr;
+        if (ImGui::Checkbox("Disk cache (results of earlier sessions)", &diskCacheEnabled))
+        {
+            m_NodeEditor->SetDiskCache(diskCacheEnabled ? GetDiskCacheDirectory() : "", DefaultDiskCacheBytes);
+            diskCache = m_NodeEditor->GetDiskCache();
+        }
+        if (diskCache)
+        {
+            ImGui::Text("Disk cache: %d hits by last edit", evalStats.DiskCacheHits);
+            ImGui::Text("Stored results: %zu (%.1f of %.0f MB in %s)", diskCache->GetEntryCount(),
+                diskCache->GetSizeInBytes() / (1024.0 * 1024.0), diskCache->GetCapacity() / (1024.0 * 1024.0), diskCache->GetDirectory().c_str());
+            int diskCacheMB = (int)(diskCache->GetCapacity() / (1024 * 1024));
+            if (ImGui::SliderInt("Disk cache size (MB)", &diskCacheMB, 0, 65536))
+                diskCache->SetCapacity((size_t)diskCacheMB * 1024 * 1024);
+            if (ImGui::Button("Clear##DiskResultCache"))
+                diskCache->Clear();
+        }
+        bool proxy = m_NodeEditor->IsProxyResolution();
+        if (ImGui::Checkbox("Proxy resolution while dragging", &proxy))
+            m_NodeEditor->SetProxyResolution(proxy);
+        float budgetMs = m_NodeEditor->GetProxyBudgetMs();
+        if (ImGui::SliderFloat("Latency budget (ms)", &budgetMs, 5.0f, 200.0f, "%.0f"))
+            m_NodeEditor->SetProxyBudgetMs(budgetMs);
+        if (evalStats.ProxyScale < 1.0)
+            ImGui::Text("Resolution: proxy 1/%d", (int)std::lround(1.0 / evalStats.ProxyScale));
+        else
+            ImGui::Text("Resolution: full");
+        ImGui::Text("Frame time: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+    }
+
+    ImGui::End();
+}
+
 Node* ImageEditorApp::CreateInputNode()
 {
     if (!m_NodeEditor)
@@ -31,6 +31,7 @@ public:
     void ShowMainMenuBar();
     void ShowNodeEditor();
     void ShowPropertiesPanel();
+    void ShowStatisticsWindow();
 
     // Node management
     Node* CreateInputNode();
@@ -40,9 +41,17 @@ public:
     // Application state
     bool m_ShowDemoWindow = false;
     bool m_ShowImGuiDemoWindow = false;
+    bool m_ShowStatisticsWindow = false;
+
+    // Heap allocations per frame (see AllocationCounter)
+    uint64_t m_FrameStartAllocations = 0;
+    uint64_t m_LastFrameAllocations = 0;
 
     // Node editor
     std::unique_ptr<NodeEditorManager> m_NodeEditor;
+    // Disk result cache: off by default, the statistics window turns it on
+    static constexpr size_t DefaultDiskCacheBytes = 4096ull * 1024 * 1024;
+    static std::string GetDiskCacheDirectory();
 
     // Active elements
     Node* m_SelectedNode = nullptr;
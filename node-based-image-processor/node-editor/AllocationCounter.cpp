@@ -0,0 +1,85 @@
+#include "AllocationCounter.h"
+#include <imgui.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef NBIP_COUNT_ALLOCATIONS
+namespace
+{
+    std::atomic<uint64_t> s_Allocations{ 0 };
+
+    void* Allocate(size_t size)
+    {
+        s_Allocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size ? size : 1);
+    }
+
+    // Same as the default operator new: retry through the new handler, then throw
+    void* AllocateOrThrow(size_t size)
+    {
+        for (;;)
+        {
+            if (void* memory = Allocate(size))
+                return memory;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void* ImGuiAllocate(size_t size, void*)
+    {
+        return Allocate(size);
+    }
+
+    void ImGuiFree(void* memory, void*)
+    {
+        std::free(memory);
+    }
+}
+
+bool AllocationCounter::IsEnabled()
+{
+    return true;
+}
+
+uint64_t AllocationCounter::GetAllocations()
+{
+    return s_Allocations.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::InstallImGuiHooks()
+{
+    ImGui::SetAllocatorFunctions(ImGuiAllocate, ImGuiFree);
+}
+
+// The replacements keep the default implementation's heap (malloc and free of the
+// shared CRT), so memory allocated by OpenCV's DLL can still be freed here and back.
+void* operator new(size_t size) { return AllocateOrThrow(size); }
+void* operator new[](size_t size) { return AllocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+#else
+bool AllocationCounter::IsEnabled()
+{
+    return false;
+}
+
+uint64_t AllocationCounter::GetAllocations()
+{
+    return 0;
+}
+
+void AllocationCounter::InstallImGuiHooks()
+{
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts the heap allocations of the application: everything allocated through
+// operator new (replaced in AllocationCounter.cpp), and ImGui's own allocations once
+// InstallImGuiHooks() ran. Images come from OpenCV's allocator, see BufferPool.
+//
+// Only built with NBIP_COUNT_ALLOCATIONS defined (the CMake option of the same name,
+// always on for the tests). Otherwise operator new is left alone and nothing is counted.
+//
+// A frame without edits should allocate nothing: the plan, the liveness and the
+// connection map are all kept from the last change. The statistics window shows the
+// count of the last frame, anything above zero on an idle graph is a regression.
+class AllocationCounter {
+public:
+    static bool IsEnabled();
+
+    // Allocations since the process started, from any thread
+    static uint64_t GetAllocations();
+
+    // Routes ImGui's allocations through the counter. Safe with a live context:
+    // the hooks use the same heap as ImGui's default ones.
+    // Does nothing unless counting is enabled.
+    static void InstallImGuiHooks();
+};
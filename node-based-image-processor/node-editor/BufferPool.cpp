@@ -0,0 +1,229 @@
+#include "BufferPool.h"
+#include "MappedBuffer.h"
+
+void BufferPool::Install()
+{
+    cv::Mat::setDefaultAllocator(this);
+}
+
+size_t BufferPool::GetClassSize(size_t bytes)
+{
+    // Round up to the next of 2^k, 1.25 * 2^k, 1.5 * 2^k and 1.75 * 2^k
+    size_t base = 1;
+    while (base <= bytes / 2)
+        base <<= 1;
+    const size_t quarter = base / 4;
+    return base + (bytes - base + quarter - 1) / quarter * quarter;
+}
+
+cv::UMatData* BufferPool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+    cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    // Same layout as OpenCV's own allocator: rows packed, or the steps of user data
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--)
+    {
+        if (step)
+        {
+            if (data0 && step[i] != cv::Mat::AUTO_STEP)
+            {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            }
+            else
+            {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = (uchar*)data0;
+    std::unique_ptr<MappedBuffer> mapped;
+    if (!data && total >= MinPooledBytes)
+        mapped = CreateMapped(total);
+
+    if (mapped)
+    {
+        data = mapped->GetData();
+    }
+    else if (!data && total >= MinPooledBytes)
+    {
+        const size_t classSize = GetClassSize(total);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.Allocations++;
+            m_Stats.BytesInUse += classSize;
+
+            auto it = m_FreeBuffers.find(classSize);
+            if (it != m_FreeBuffers.end() && !it->second.empty())
+            {
+                data = (uchar*)it->second.back();
+                it->second.pop_back();
+                m_Stats.BytesRetained -= classSize;
+                m_Stats.PoolHits++;
+            }
+            else
+            {
+                m_Stats.SystemAllocations++;
+            }
+        }
+        if (!data)
+            data = (uchar*)cv::fastMalloc(classSize);
+    }
+    else if (!data)
+    {
+        data = (uchar*)cv::fastMalloc(total);
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    u->userdata = mapped.release(); // Only mapped buffers have user data, see IsMapped()
+    if (data0)
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+std::unique_ptr<MappedBuffer> BufferPool::CreateMapped(size_t bytes) const
+{
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_MappedMinBytes == 0 || bytes < m_MappedMinBytes)
+            return nullptr;
+        directory = m_ScratchDirectory;
+    }
+
+    // Creating the file takes a while, other allocations go on meanwhile
+    std::unique_ptr<MappedBuffer> mapped = MappedBuffer::Create(directory, bytes);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (!mapped)
+    {
+        m_Stats.MappingFailures++;
+        return nullptr;
+    }
+    m_Stats.MappedBuffers++;
+    m_Stats.MappedBytes += bytes;
+    return mapped;
+}
+
+bool BufferPool::allocate(cv::UMatData* data, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return data != nullptr;
+}
+
+void BufferPool::deallocate(cv::UMatData* u) const
+{
+    if (!u)
+        return;
+
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (u->userdata)
+    {
+        // Unmapping deletes the scratch file with whatever was paged out to it
+        MappedBuffer* mapped = (MappedBuffer*)u->userdata;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.MappedBuffers--;
+            m_Stats.MappedBytes -= mapped->GetSize();
+        }
+        delete mapped;
+        u->userdata = nullptr;
+        u->origdata = nullptr;
+    }
+    else if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+    {
+        if (u->size >= MinPooledBytes)
+        {
+            // The class follows from the size, the buffer goes back to its free list
+            const size_t classSize = GetClassSize(u->size);
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.BytesInUse -= classSize;
+            m_FreeBuffers[classSize].push_back(u->origdata);
+            m_Stats.BytesRetained += classSize;
+            TrimTo(m_MaxRetainedBytes);
+        }
+        else
+        {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+void BufferPool::SetMaxRetainedBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MaxRetainedBytes = bytes;
+    TrimTo(m_MaxRetainedBytes);
+}
+
+size_t BufferPool::GetMaxRetainedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_MaxRetainedBytes;
+}
+
+void BufferPool::Trim()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    TrimTo(0);
+}
+
+void BufferPool::TrimTo(size_t maxBytes) const
+{
+    // Largest classes first, they free the most for the fewest buffers
+    while (m_Stats.BytesRetained > maxBytes)
+    {
+        auto largest = m_FreeBuffers.end();
+        for (auto it = m_FreeBuffers.begin(); it != m_FreeBuffers.end(); ++it)
+        {
+            if (!it->second.empty() && (largest == m_FreeBuffers.end() || it->first > largest->first))
+                largest = it;
+        }
+        if (largest == m_FreeBuffers.end())
+            break;
+
+        cv::fastFree(largest->second.back());
+        largest->second.pop_back();
+        m_Stats.BytesRetained -= largest->first;
+    }
+}
+
+void BufferPool::SetMappedMinBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MappedMinBytes = bytes;
+}
+
+size_t BufferPool::GetMappedMinBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_MappedMinBytes;
+}
+
+void BufferPool::SetScratchDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_ScratchDirectory = directory;
+}
+
+BufferPoolStats BufferPool::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
+
+void BufferPool::ResetStats()
+{
+    // Byte counts describe the current state, only the counters restart
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.Allocations = 0;
+    m_Stats.PoolHits = 0;
+    m_Stats.SystemAllocations = 0;
+    m_Stats.MappingFailures = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MappedBuffer;
+
+// Counters describing how image buffers were allocated
+struct BufferPoolStats {
+    uint64_t Allocations = 0;   // Pooled-size buffers handed out
+    uint64_t PoolHits = 0;      // ... of which reused a buffer returned earlier
+    uint64_t SystemAllocations = 0; // ... of which had to come from the system
+    size_t BytesInUse = 0;      // Capacity of the pooled buffers currently handed out
+    size_t BytesRetained = 0;   // Capacity of the free buffers kept for reuse
+    int MappedBuffers = 0;      // Buffers currently backed by scratch files
+    size_t MappedBytes = 0;     // Their size
+    uint64_t MappingFailures = 0; // Scratch files that could not be created, allocated in RAM instead
+};
+
+// cv::MatAllocator that recycles large pixel buffers instead of returning them to
+// the system.
+//
+// Every evaluation allocates the same images again: node outputs, row band results,
+// cvtColor temporaries of the previews. Freed buffers of at least MinPooledBytes are
+// kept on a free list per size class (four classes per power of two, so at most 25%
+// of a buffer is slack) and handed out again to the next allocation of that class.
+// While a slider is dragged the sizes repeat, and the steady state allocates nothing
+// from the system. Smaller buffers go to cv::fastMalloc as usual.
+//
+// Buffers of at least SetMappedMinBytes() bytes are not pooled but backed by scratch
+// files mapped into memory (see MappedBuffer), so that gigapixel images and their
+// intermediates can exceed RAM. Decoded files, node outputs and copies all come from
+// here, no node has to know.
+//
+// Installed as OpenCV's default allocator, so it also serves the temporaries inside
+// OpenCV. All methods are thread-safe.
+class BufferPool : public cv::MatAllocator {
+public:
+    // Never destroyed: Mats allocated by the pool may outlive any static destructor
+    static BufferPool& GetInstance() {
+        static BufferPool* instance = new BufferPool();
+        return *instance;
+    }
+
+    // Makes the pool OpenCV's default allocator
+    void Install();
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+        cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    // Free buffers beyond this are released to the system
+    void SetMaxRetainedBytes(size_t bytes);
+    size_t GetMaxRetainedBytes() const;
+    // Releases every free buffer to the system
+    void Trim();
+
+    // Buffers of at least this many bytes are backed by scratch files in 'directory'
+    // (the system temporary directory if empty). 0 keeps every buffer in RAM.
+    void SetMappedMinBytes(size_t bytes);
+    size_t GetMappedMinBytes() const;
+    void SetScratchDirectory(const std::string& directory);
+    // True for the buffer of a Mat backed by a scratch file
+    bool IsMapped(const cv::UMatData* u) const { return u && u->currAllocator == this && u->userdata; }
+
+    BufferPoolStats GetStats() const;
+    void ResetStats();
+
+    static constexpr size_t MinPooledBytes = 64 * 1024;
+    static constexpr size_t DefaultMappedMinBytes = 1024ull * 1024 * 1024;
+
+private:
+    BufferPool() = default;
+
+    static size_t GetClassSize(size_t bytes);
+    // Releases free buffers until at most 'maxBytes' are retained. Requires m_Mutex.
+    void TrimTo(size_t maxBytes) const;
+    // A scratch file backed buffer if 'bytes' is at least the mapped size, else nullptr
+    std::unique_ptr<MappedBuffer> CreateMapped(size_t bytes) const;
+
+    mutable std::mutex m_Mutex;
+    mutable std::unordered_map<size_t, std::vector<void*>> m_FreeBuffers; // Class size -> free buffers
+    mutable BufferPoolStats m_Stats;
+    size_t m_MaxRetainedBytes = 1024ull * 1024 * 1024;
+    size_t m_MappedMinBytes = DefaultMappedMinBytes;
+    std::string m_ScratchDirectory;
+};
@@ -0,0 +1,186 @@
+#include "Compression.h"
+#include <cstring>
+
+namespace {
+    // Lengths beyond what fits in a token continue in bytes of 255, ended by a smaller one
+    void WriteLength(std::vector<uint8_t>& output, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+            output.push_back(255);
+        output.push_back((uint8_t)length);
+    }
+
+    bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (ip >= end)
+                return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    constexpr int LzHashBits = 16;
+    constexpr size_t LzMinMatch = 4;
+    constexpr size_t LzMaxOffset = 65535;
+
+    void WriteLzSequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        const size_t matchCode = matchLength ? matchLength - LzMinMatch : 0;
+        output.push_back((uint8_t)((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+        if (literalCount >= 15)
+            WriteLength(output, literalCount - 15);
+        output.insert(output.end(), literals, literals + literalCount);
+        if (matchLength == 0)
+            return;
+
+        output.push_back((uint8_t)(offset & 0xff));
+        output.push_back((uint8_t)(offset >> 8));
+        if (matchCode >= 15)
+            WriteLength(output, matchCode - 15);
+    }
+}
+
+bool Compression::CompressRunLength(const uint8_t* data, size_t size, size_t maxSize, std::vector<uint8_t>& output)
+{
+    // Pairs of a byte and its run length, the length as a little-endian base-128 varint
+    output.clear();
+    for (size_t i = 0; i < size;)
+    {
+        const uint8_t value = data[i];
+        size_t run = 1;
+        while (i + run < size && data[i + run] == value)
+            run++;
+        i += run;
+
+        output.push_back(value);
+        for (; run >= 0x80; run >>= 7)
+            output.push_back((uint8_t)(run | 0x80));
+        output.push_back((uint8_t)run);
+
+        if (output.size() >= maxSize)
+            return false;
+    }
+    return true;
+}
+
+bool Compression::CompressLz(const uint8_t* data, size_t size, size_t maxSize, std::vector<uint8_t>& output)
+{
+    // Greedy matching against the last position of every 4-byte hash. The last bytes are
+    // always literals, so matches never read past the end.
+    output.clear();
+    std::vector<uint32_t> table(1u << LzHashBits, 0); // Position + 1, 0 if none
+    const size_t matchLimit = size > 12 ? size - 12 : 0;
+    size_t anchor = 0;
+    size_t ip = 0;
+    while (ip < matchLimit)
+    {
+        const uint32_t sequence = Read32(data + ip);
+        const uint32_t hash = (sequence * 2654435761u) >> (32 - LzHashBits);
+        const size_t candidate = table[hash];
+        table[hash] = (uint32_t)(ip + 1);
+
+        if (candidate == 0 || ip - (candidate - 1) > LzMaxOffset || Read32(data + candidate - 1) != sequence)
+        {
+            ip++;
+            continue;
+        }
+
+        const size_t match = candidate - 1;
+        size_t length = LzMinMatch;
+        while (ip + length < size - 5 && data[match + length] == data[ip + length])
+            length++;
+
+        WriteLzSequence(output, data + anchor, ip - anchor, ip - match, length);
+        ip += length;
+        anchor = ip;
+        if (output.size() >= maxSize)
+            return false;
+    }
+
+    WriteLzSequence(output, data + anchor, size - anchor, 0, 0);
+    return output.size() < maxSize;
+}
+
+bool Compression::Decompress(Codec codec, const std::vector<uint8_t>& input, uint8_t* output, size_t size)
+{
+    const uint8_t* ip = input.data();
+    const uint8_t* end = ip + input.size();
+    size_t op = 0;
+
+    if (codec == Codec::RunLength)
+    {
+        while (ip < end)
+        {
+            const uint8_t value = *ip++;
+            size_t run = 0;
+            for (int shift = 0;; shift += 7)
+            {
+                if (ip >= end || shift > 56)
+                    return false;
+                const uint8_t byte = *ip++;
+                run |= (size_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            if (run > size - op)
+                return false;
+            memset(output + op, value, run);
+            op += run;
+        }
+        return op == size;
+    }
+
+    if (codec == Codec::Lz)
+    {
+        while (ip < end)
+        {
+            const uint8_t token = *ip++;
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && !ReadLength(ip, end, literalCount))
+                return false;
+            if (literalCount > (size_t)(end - ip) || literalCount > size - op)
+                return false;
+            memcpy(output + op, ip, literalCount);
+            ip += literalCount;
+            op += literalCount;
+            if (ip == end)
+                break; // The last sequence has no match
+
+            if (end - ip < 2)
+                return false;
+            const size_t offset = ip[0] | (size_t)ip[1] << 8;
+            ip += 2;
+            size_t length = token & 15;
+            if (length == 15 && !ReadLength(ip, end, length))
+                return false;
+            length += LzMinMatch;
+            if (offset == 0 || offset > op || length > size - op)
+                return false;
+
+            // Matches may overlap what they produce (runs), copy byte by byte then
+            const uint8_t* match = output + op - offset;
+            if (offset >= length)
+                memcpy(output + op, match, length);
+            else
+            {
+                for (size_t k = 0; k < length; k++)
+                    output[op + k] = match[k];
+            }
+            op += length;
+        }
+        return op == size;
+    }
+
+    return false;
+}
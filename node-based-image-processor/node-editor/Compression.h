@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fast lossless codecs for image buffers kept in memory, see
+// NodeEditorManager::CompressColdImages and ImageDataManager::CompressImage.
+namespace Compression {
+    enum class Codec : uint8_t {
+        None,
+        RunLength, // Runs of equal bytes: binary masks, edge maps, flat channels
+        Lz         // LZ77 with 64 KB window and byte-aligned tokens: everything else
+    };
+
+    // Encode 'size' bytes. Returns false if the result would not be smaller than
+    // 'maxSize' bytes, 'output' is then unspecified.
+    bool CompressRunLength(const uint8_t* data, size_t size, size_t maxSize, std::vector<uint8_t>& output);
+    bool CompressLz(const uint8_t* data, size_t size, size_t maxSize, std::vector<uint8_t>& output);
+
+    // Decode into 'output', which has room for exactly the original size. Returns false
+    // on corrupt input.
+    bool Decompress(Codec codec, const std::vector<uint8_t>& input, uint8_t* output, size_t size);
+}
@@ -0,0 +1,335 @@
+#include "DiskResultCache.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+    // Entry files: FileHeader, then per image a MatHeader followed by its rows unless it
+    // repeats an earlier image, then the values. All in the byte order of the machine.
+    // The index file is IndexMagic and the version, then an IndexRecord per entry.
+    constexpr uint32_t EntryMagic = 0x3143524e; // "NRC1"
+    constexpr uint32_t IndexMagic = 0x3149524e; // "NRI1"
+    constexpr const char* IndexFileName = "index.bin";
+    constexpr const char* EntryPattern = "*.nrc";
+
+    struct FileHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;  // DiskResultCache::Version of the build that wrote the entry
+        uint64_t Key;      // Key the entry was stored under
+        uint32_t OutputCount;
+        uint32_t ExtraCount;
+        uint32_t ValueCount;
+    };
+
+    struct MatHeader
+    {
+        int32_t Rows;
+        int32_t Cols;
+        int32_t Type;
+        int32_t SameAs; // Index of an earlier image sharing the same pixels, or -1
+    };
+
+    struct IndexRecord
+    {
+        uint64_t Key;
+        uint64_t Bytes;
+        uint64_t LastUse;
+    };
+
+    // The images of 'results' in file order
+    std::vector<const cv::Mat*> ListImages(const NodeResults& results)
+    {
+        std::vector<const cv::Mat*> images;
+        for (const cv::Mat& image : results.Outputs)
+            images.push_back(&image);
+        images.push_back(&results.OutputImage);
+        images.push_back(&results.PreviewImage);
+        for (const cv::Mat& image : results.Extra)
+            images.push_back(&image);
+        return images;
+    }
+
+    bool WriteResults(std::ofstream& file, size_t key, const NodeResults& results)
+    {
+        FileHeader header{ EntryMagic, DiskResultCache::Version, (uint64_t)key,
+            (uint32_t)results.Outputs.size(), (uint32_t)results.Extra.size(), (uint32_t)results.Values.size() };
+        file.write((const char*)&header, sizeof(header));
+
+        const std::vector<const cv::Mat*> images = ListImages(results);
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            const cv::Mat& image = *images[i];
+            MatHeader matHeader{ image.rows, image.cols, image.type(), -1 };
+            for (size_t k = 0; k < i && matHeader.SameAs < 0; k++)
+            {
+                if (!image.empty() && images[k]->data == image.data && images[k]->size() == image.size() &&
+                    images[k]->type() == image.type() && images[k]->step == image.step)
+                    matHeader.SameAs = (int32_t)k;
+            }
+            file.write((const char*)&matHeader, sizeof(matHeader));
+            if (matHeader.SameAs >= 0 || image.empty())
+                continue;
+
+            // Rows of a submatrix are not contiguous
+            const size_t rowBytes = image.cols * image.elemSize();
+            if (image.isContinuous())
+                file.write((const char*)image.data, rowBytes * image.rows);
+            else
+            {
+                for (int y = 0; y < image.rows; y++)
+                    file.write((const char*)image.ptr(y), rowBytes);
+            }
+        }
+
+        if (!results.Values.empty())
+            file.write((const char*)results.Values.data(), results.Values.size() * sizeof(double));
+        return (bool)file;
+    }
+
+    bool ReadResults(std::ifstream& file, size_t key, NodeResults& results)
+    {
+        // Results of another version may have been computed differently
+        FileHeader header;
+        if (!file.read((char*)&header, sizeof(header)) || header.Magic != EntryMagic ||
+            header.Version != DiskResultCache::Version || header.Key != (uint64_t)key)
+            return false;
+
+        results.Outputs.resize(header.OutputCount);
+        results.Extra.resize(header.ExtraCount);
+        std::vector<cv::Mat*> images;
+        for (cv::Mat& image : results.Outputs)
+            images.push_back(&image);
+        images.push_back(&results.OutputImage);
+        images.push_back(&results.PreviewImage);
+        for (cv::Mat& image : results.Extra)
+            images.push_back(&image);
+
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            MatHeader matHeader;
+            if (!file.read((char*)&matHeader, sizeof(matHeader)))
+                return false;
+            if (matHeader.SameAs >= 0)
+            {
+                if ((size_t)matHeader.SameAs >= i)
+                    return false;
+                *images[i] = *images[matHeader.SameAs];
+                continue;
+            }
+            if (matHeader.Rows <= 0 || matHeader.Cols <= 0)
+                continue;
+
+            images[i]->create(matHeader.Rows, matHeader.Cols, matHeader.Type);
+            if (!file.read((char*)images[i]->data, images[i]->total() * images[i]->elemSize()))
+                return false;
+        }
+
+        results.Values.resize(header.ValueCount);
+        if (!results.Values.empty() && !file.read((char*)results.Values.data(), results.Values.size() * sizeof(double)))
+            return false;
+        return true;
+    }
+}
+
+DiskResultCache::DiskResultCache(const std::string& directory, size_t capacityBytes)
+    : m_Directory(directory), m_Capacity(capacityBytes)
+{
+    cv::utils::fs::createDirectories(m_Directory);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ReadIndex();
+    Trim();
+}
+
+DiskResultCache::~DiskResultCache()
+{
+    // Loads only touch the index in memory, save their order for the next session
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    WriteIndex();
+}
+
+std::string DiskResultCache::GetEntryPath(size_t key) const
+{
+    std::ostringstream name;
+    name << std::hex << (uint64_t)key << ".nrc";
+    return cv::utils::fs::join(m_Directory, name.str());
+}
+
+std::shared_ptr<NodeResults> DiskResultCache::Load(size_t key)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Entries.find(key);
+        if (it == m_Entries.end())
+            return nullptr;
+        it->second.LastUse = ++m_UseCounter;
+    }
+
+    // The entry may be evicted meanwhile, the read then fails like a miss
+    auto results = std::make_shared<NodeResults>();
+    std::ifstream file(GetEntryPath(key), std::ios::binary);
+    if (!file || !ReadResults(file, key, *results))
+        return nullptr;
+    return results;
+}
+
+bool DiskResultCache::Contains(size_t key) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.count(key) != 0;
+}
+
+void DiskResultCache::Store(size_t key, const NodeResults& results)
+{
+    // Written under a temporary name and renamed, so a reader never sees half a file
+    const std::string path = GetEntryPath(key);
+    const std::string writePath = path + ".tmp";
+    size_t bytes = 0;
+    {
+        std::ofstream file(writePath, std::ios::binary | std::ios::trunc);
+        if (!file || !WriteResults(file, key, results))
+        {
+            file.close();
+            std::remove(writePath.c_str());
+            return;
+        }
+        bytes = (size_t)file.tellp();
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (bytes > m_Capacity)
+    {
+        std::remove(writePath.c_str());
+        return;
+    }
+
+    // rename() does not replace an existing file on every platform, remove it first
+    auto it = m_Entries.find(key);
+    if (it != m_Entries.end())
+    {
+        m_Size -= it->second.Bytes;
+        m_Entries.erase(it);
+    }
+    std::remove(path.c_str());
+    if (std::rename(writePath.c_str(), path.c_str()) != 0)
+    {
+        std::remove(writePath.c_str());
+        return;
+    }
+
+    m_Entries[key] = { bytes, ++m_UseCounter };
+    m_Size += bytes;
+    Trim();
+    m_IndexDirty = true;
+}
+
+void DiskResultCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (const auto& entry : m_Entries)
+        std::remove(GetEntryPath(entry.first).c_str());
+    m_Entries.clear();
+    m_Size = 0;
+    WriteIndex();
+}
+
+void DiskResultCache::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_IndexDirty)
+        WriteIndex();
+}
+
+void DiskResultCache::SetCapacity(size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Capacity = capacityBytes;
+    Trim();
+    m_IndexDirty = true;
+}
+
+size_t DiskResultCache::GetCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Capacity;
+}
+
+size_t DiskResultCache::GetSizeInBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Size;
+}
+
+size_t DiskResultCache::GetEntryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.size();
+}
+
+void DiskResultCache::Trim()
+{
+    if (m_Size <= m_Capacity)
+        return;
+
+    std::vector<std::pair<uint64_t, size_t>> byLastUse;
+    byLastUse.reserve(m_Entries.size());
+    for (const auto& entry : m_Entries)
+        byLastUse.emplace_back(entry.second.LastUse, entry.first);
+    std::sort(byLastUse.begin(), byLastUse.end());
+
+    for (size_t i = 0; i < byLastUse.size() && m_Size > m_Capacity; i++)
+    {
+        const size_t key = byLastUse[i].second;
+        std::remove(GetEntryPath(key).c_str());
+        m_Size -= m_Entries[key].Bytes;
+        m_Entries.erase(key);
+        m_IndexDirty = true;
+    }
+}
+
+void DiskResultCache::ReadIndex()
+{
+    std::ifstream file(cv::utils::fs::join(m_Directory, IndexFileName), std::ios::binary);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (!file || !file.read((char*)&magic, sizeof(magic)) || magic != IndexMagic ||
+        !file.read((char*)&version, sizeof(version)) || version != Version)
+    {
+        // No index, or one of another version: none of the entries can be trusted
+        file.close();
+        std::vector<cv::String> paths;
+        cv::utils::fs::glob(m_Directory, EntryPattern, paths);
+        for (const cv::String& path : paths)
+            std::remove(path.c_str());
+        return;
+    }
+
+    // Entries whose file went missing are dropped
+    IndexRecord record;
+    while (file.read((char*)&record, sizeof(record)))
+    {
+        if (!cv::utils::fs::exists(GetEntryPath((size_t)record.Key)))
+            continue;
+        m_Entries[(size_t)record.Key] = { (size_t)record.Bytes, record.LastUse };
+        m_Size += (size_t)record.Bytes;
+        m_UseCounter = std::max(m_UseCounter, record.LastUse);
+    }
+}
+
+void DiskResultCache::WriteIndex()
+{
+    m_IndexDirty = false;
+    const std::string path = cv::utils::fs::join(m_Directory, IndexFileName);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&IndexMagic, sizeof(IndexMagic));
+    file.write((const char*)&Version, sizeof(Version));
+    for (const auto& entry : m_Entries)
+    {
+        IndexRecord record{ (uint64_t)entry.first, (uint64_t)entry.second.Bytes, entry.second.LastUse };
+        file.write((const char*)&record, sizeof(record));
+    }
+}
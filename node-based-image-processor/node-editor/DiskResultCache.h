@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Node.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// On-disk counterpart of ResultCache, so results survive the session.
+//
+// Every entry is one file in the cache directory, named after its key and holding the
+// images of a NodeResults as raw pixel rows behind a small header: no encoding, loading
+// is a read per image. Images shared between the results (a node's output and its
+// output pin) are written once. An index file keeps the size and last use of every
+// entry, the least recently used ones are deleted once the directory exceeds its cap.
+//
+// Keys have to be stable across sessions, see NodeEditorManager::ComputeCacheKeys.
+// They do not cover how a node computes its results, so every file carries Version
+// and the key it was stored under: entries of another version are never returned, and
+// a directory written by another version is emptied when opened.
+// All methods are thread-safe. Entry files are read and written outside the lock;
+// renaming a new one into place and deleting evicted ones happen under it. The index
+// is rewritten by Flush() and on destruction, not by every Store().
+class DiskResultCache {
+public:
+    // Bump whenever the file layout, or what any node's Process() computes, changes
+    static constexpr uint32_t Version = 2;
+
+    DiskResultCache(const std::string& directory, size_t capacityBytes);
+    ~DiskResultCache();
+
+    DiskResultCache(const DiskResultCache&) = delete;
+    DiskResultCache& operator=(const DiskResultCache&) = delete;
+
+    // The results stored under 'key', or null if there are none or the file is unreadable
+    std::shared_ptr<NodeResults> Load(size_t key);
+    bool Contains(size_t key) const;
+    void Store(size_t key, const NodeResults& results);
+    void Clear();
+    // Rewrites the index if entries changed since the last call
+    void Flush();
+
+    void SetCapacity(size_t capacityBytes);
+    size_t GetCapacity() const;
+    size_t GetSizeInBytes() const;
+    size_t GetEntryCount() const;
+    const std::string& GetDirectory() const { return m_Directory; }
+
+private:
+    struct Entry {
+        size_t Bytes;
+        uint64_t LastUse; // Value of m_UseCounter when last stored or loaded
+    };
+
+    std::string GetEntryPath(size_t key) const;
+    // Deletes least recently used entries until the directory fits its capacity. Requires m_Mutex.
+    void Trim();
+    // Loads the index, or empties the directory if it was written by another version
+    void ReadIndex();
+    // Rewrites the index file. Requires m_Mutex.
+    void WriteIndex();
+
+    mutable std::mutex m_Mutex;
+    std::string m_Directory;
+    std::unordered_map<size_t, Entry> m_Entries;
+    size_t m_Capacity;
+    size_t m_Size = 0;
+    uint64_t m_UseCounter = 0;
+    bool m_IndexDirty = false; // Entries changed since the index was written
+};
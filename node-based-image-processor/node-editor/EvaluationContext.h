@@ -0,0 +1,48 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
+
+// Per-evaluation state handed to Node::Process().
+//
+// An evaluation that has been superseded (for example by a newer slider value)
+// is cancelled. Nodes are expected to check IsCancelled() between chunks of
+// work - usually by processing their image in row bands with ForEachRowBand() -
+// and return early; the evaluation engine discards whatever they left behind
+// and runs them again with the new parameters.
+class EvaluationContext {
+public:
+    // Rows processed between two cancellation checks
+    static constexpr int RowBandHeight = 64;
+
+    bool IsCancelled() const { return m_Cancelled.load(std::memory_order_relaxed); }
+    void Cancel() { m_Cancelled.store(true, std::memory_order_relaxed); }
+
+    // Resolution of this evaluation relative to the full images. Below 1 while an edit
+    // is previewed on downscaled proxies of the inputs (see InputNode::Process).
+    double GetProxyScale() const { return m_ProxyScale; }
+    void SetProxyScale(double scale) { m_ProxyScale = scale; }
+
+    // Call 'processBand' for consecutive bands of rows covering [0, rows), checking
+    // for cancellation before each band. Returns false if the evaluation was cancelled.
+    // Neighborhood filters give exact results per band as long as they run on row
+    // ranges of the full image (OpenCV reads the rows around a submatrix as border).
+    template <typename BandFunction>
+    bool ForEachRowBand(int rows, BandFunction&& processBand) const
+    {
+        for (int start = 0; start < rows; start += RowBandHeight)
+        {
+            if (IsCancelled())
+                return false;
+
+            processBand(cv::Range(start, std::min(start + RowBandHeight, rows)));
+        }
+
+        return !IsCancelled();
+    }
+
+private:
+    std::atomic<bool> m_Cancelled{ false };
+    double m_ProxyScale = 1.0;
+};
@@ -1,14 +1,45 @@
 #include "ImageDataManager.h"
+#include "BufferPool.h"
+#include <opencv2/core/utils/logger.hpp>
+#include <algorithm>
+
+static size_t ImageBytes(const cv::Mat& image)
+{
+    return image.total() * image.elemSize();
+}
+
+// Largest finite half precision value, and the smallest normal one
+static constexpr double HalfMax = 65504.0;
+static constexpr double HalfMinNormal = 1.0 / 16384;
 
 void ImageDataManager::SetImageData(ed::PinId outputPinId, const cv::Mat& image)
 {
     // Store the image data for the output pin
     uint64_t pinId = outputPinId.Get();
+
+    // Converted before taking the lock, the workers publish concurrently
+    cv::Mat converted = image;
+    if (image.depth() == CV_32F && GetHalfPrecisionStorage())
+    {
+        cv::Mat half = ToHalfPrecision(image);
+        if (!half.empty())
+            converted = half;
+    }
     
-    // Clone the image to ensure we have our own copy
+    // The replaced image is released after the lock is dropped
+    cv::Mat previous;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Share the producer's buffer - published images are immutable, so no clone is needed
     if (!image.empty())
     {
-        m_ImageData[pinId] = image.clone();
+        ImageEntry& stored = m_ImageData[pinId];
+        previous = stored.Image;
+        stored = ImageEntry();
+        stored.Image = converted;
+        stored.LastUse = ++m_UseCounter;
+        m_Stats.SharedHandoffs++;
+        m_Stats.SharedBytes += ImageBytes(image);
     }
     else
     {   
@@ -16,6 +47,7 @@ void ImageDataManager::SetImageData(ed::PinId outputPinId, const cv::Mat& image)
         auto it = m_ImageData.find(pinId);
         if (it != m_ImageData.end())
         {
+            previous = it->second.Image;
             m_ImageData.erase(it);
         }
     }
@@ -24,39 +56,440 @@ void ImageDataManager::SetImageData(ed::PinId outputPinId, const cv::Mat& image)
 cv::Mat ImageDataManager::GetImageData(ed::PinId inputPinId)
 {
     uint64_t pinId = inputPinId.Get();
-    
-    // Check if this input pin is connected to an output pin
-    auto connIt = m_Connections.find(pinId);
+    cv::Mat image;
+    ImageEntry compressed;
+    uint64_t outputPinId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // Check if this input pin is connected to an output pin
+        auto connIt = m_Connections.find(pinId);
+        if (connIt == m_Connections.end())
+        {
+            // No connection, return empty image
+            return cv::Mat();
+        }
+
+        // Get the output pin ID this input is connected to
+        outputPinId = connIt->second;
+
+        // Look up the image data for the output pin
+        auto it = m_ImageData.find(outputPinId);
+        if (it == m_ImageData.end())
+        {
+            // No image data available, return empty image
+            return cv::Mat();
+        }
+
+        // Return a view of the shared buffer, which the caller must not modify
+        image = GetImageLocked(it->second, compressed);
+        if (!compressed.Compressed && image.depth() != CV_16F)
+        {
+            m_Stats.SharedHandoffs++;
+            m_Stats.SharedBytes += ImageBytes(image);
+        }
+    }
+    if (compressed.Compressed)
+        image = DecompressImage(outputPinId, compressed);
+
+    // Half precision images are private single precision copies instead
+    return ToSinglePrecision(image);
+}
+
+cv::Mat ImageDataManager::GetStoredData(ed::PinId outputPinId)
+{
+    cv::Mat image;
+    ImageEntry compressed;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto it = m_ImageData.find(outputPinId.Get());
+        if (it == m_ImageData.end())
+            return cv::Mat();
+        image = GetImageLocked(it->second, compressed);
+    }
+    return compressed.Compressed ? DecompressImage(outputPinId.Get(), compressed) : image;
+}
+
+void ImageDataManager::ClearImageData(ed::PinId outputPinId)
+{
+    // The removed image is released after the lock is dropped
+    cv::Mat previous;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_ImageData.find(outputPinId.Get());
+    if (it != m_ImageData.end())
+    {
+        previous = it->second.Image;
+        m_ImageData.erase(it);
+    }
+}
+
+uint64_t ImageDataManager::BumpVersion(ed::PinId outputPinId)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    uint64_t version = ++m_LastVersion;
+    m_Versions[outputPinId.Get()] = version;
+    return version;
+}
+
+uint64_t ImageDataManager::GetVersionLocked(uint64_t outputPinId) const
+{
+    auto it = m_Versions.find(outputPinId);
+    return (it != m_Versions.end()) ? it->second : 0;
+}
+
+uint64_t ImageDataManager::GetVersion(ed::PinId outputPinId) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return GetVersionLocked(outputPinId.Get());
+}
+
+uint64_t ImageDataManager::GetInputVersion(ed::PinId inputPinId) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto connIt = m_Connections.find(inputPinId.Get());
     if (connIt == m_Connections.end())
+        return 0;
+
+    return GetVersionLocked(connIt->second);
+}
+
+size_t ImageDataManager::GetMemoryUsage(const std::vector<cv::Mat>& heldImages) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Pins share buffers (a channel split passing its input through), count each once
+    std::unordered_set<const cv::UMatData*> buffers;
+    const BufferPool& bufferPool = BufferPool::GetInstance();
+    size_t bytes = 0;
+    for (const auto& entry : m_ImageData)
     {
-        // No connection, return empty image
-        return cv::Mat();
+        if (entry.second.Compressed)
+            bytes += entry.second.Compressed->size();
+        const cv::Mat& image = entry.second.Image;
+        if (bufferPool.IsMapped(image.u))
+            continue;
+        if (!image.u || buffers.insert(image.u).second)
+            bytes += image.u ? image.u->size : ImageBytes(image);
     }
-    
-    // Get the output pin ID this input is connected to
-    uint64_t outputPinId = connIt->second;
-    
-    // Look up the image data for the output pin
-    auto it = m_ImageData.find(outputPinId);
+
+    // Node references keep buffers alive after their pins were cleared
+    for (const cv::Mat& image : heldImages)
+    {
+        if (image.u && !bufferPool.IsMapped(image.u) && buffers.insert(image.u).second)
+            bytes += image.u->size;
+    }
+    return bytes;
+}
+
+std::vector<uint64_t> ImageDataManager::GetOutputPinsByLastUse() const
+{
+    std::vector<std::pair<uint64_t, uint64_t>> pins;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        pins.reserve(m_ImageData.size());
+        for (const auto& entry : m_ImageData)
+            pins.emplace_back(entry.second.LastUse, entry.first);
+    }
+
+    std::sort(pins.begin(), pins.end());
+    std::vector<uint64_t> order;
+    order.reserve(pins.size());
+    for (const auto& pin : pins)
+        order.push_back(pin.second);
+    return order;
+}
+
+PinMemoryUsage ImageDataManager::GetPinMemoryUsage(ed::PinId outputPinId) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    PinMemoryUsage usage;
+    auto it = m_ImageData.find(outputPinId.Get());
     if (it == m_ImageData.end())
+        return usage;
+
+    const ImageEntry& entry = it->second;
+    if (entry.Codec != Compression::Codec::None)
+    {
+        usage.Bytes = entry.Compressed->size();
+        usage.HalfPrecision = CV_MAT_DEPTH(entry.Type) == CV_16F;
+        usage.Compressed = true;
+    }
+    else
     {
-        // No image data available, return empty image
+        usage.Bytes = entry.Image.u ? entry.Image.u->size : ImageBytes(entry.Image);
+        usage.HalfPrecision = entry.Image.depth() == CV_16F;
+        usage.Mapped = BufferPool::GetInstance().IsMapped(entry.Image.u);
+    }
+    return usage;
+}
+
+void ImageDataManager::SetHalfPrecisionStorage(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_HalfPrecision = enabled;
+}
+
+bool ImageDataManager::GetHalfPrecisionStorage() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_HalfPrecision;
+}
+
+void ImageDataManager::SetHalfPrecisionCheck(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_HalfPrecisionCheck = enabled;
+}
+
+bool ImageDataManager::GetHalfPrecisionCheck() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_HalfPrecisionCheck;
+}
+
+cv::Mat ImageDataManager::ToHalfPrecision(const cv::Mat& image)
+{
+    // Anything beyond the largest half value would turn into an infinity. checkRange
+    // also fails on infinities and NaNs, which are rare enough to keep as they are.
+    if (!cv::checkRange(image, true, nullptr, -HalfMax, HalfMax + 1.0))
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.HalfPrecisionRejected++;
         return cv::Mat();
     }
-    
-    // Return the image data (return a clone to prevent modification)
-    return it->second.clone();
+
+    // convertTo rounds to nearest with the F16C/NEON conversion instructions where the
+    // CPU has them, 8 values per instruction
+    cv::Mat half;
+    image.convertTo(half, CV_16F);
+
+    if (GetHalfPrecisionCheck())
+    {
+        // Relative to the value, or to the smallest normal number below it, where the
+        // spacing of half values stops shrinking
+        cv::Mat roundTrip, error;
+        half.convertTo(roundTrip, CV_32F);
+        cv::Mat original = image.isContinuous() ? image : image.clone();
+        original = original.reshape(1);
+        roundTrip = roundTrip.reshape(1);
+        cv::absdiff(original, roundTrip, error);
+        cv::Mat scale = cv::abs(original);
+        cv::max(scale, HalfMinNormal, scale);
+        cv::divide(error, scale, error);
+
+        double maxError = 0.0;
+        cv::minMaxIdx(error, nullptr, &maxError);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.MaxHalfPrecisionError = std::max(m_Stats.MaxHalfPrecisionError, maxError);
+    }
+    return half;
+}
+
+cv::Mat ImageDataManager::ToSinglePrecision(const cv::Mat& image)
+{
+    if (image.depth() != CV_16F)
+        return image;
+
+    cv::Mat single;
+    image.convertTo(single, CV_32F);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.HalfPrecisionDecodes++;
+    return single;
+}
+
+cv::Mat ImageDataManager::GetImageLocked(ImageEntry& entry, ImageEntry& compressed)
+{
+    entry.LastUse = ++m_UseCounter;
+    entry.IdleEvaluations = 0;
+    if (entry.Codec == Compression::Codec::None)
+        return entry.Image;
+
+    // The payload is immutable and shared, decompressing it does not need the lock
+    compressed.Codec = entry.Codec;
+    compressed.Compressed = entry.Compressed;
+    compressed.Size = entry.Size;
+    compressed.Type = entry.Type;
+    return cv::Mat();
+}
+
+cv::Mat ImageDataManager::DecompressImage(uint64_t outputPinId, const ImageEntry& compressed)
+{
+    cv::Mat image(compressed.Size, compressed.Type);
+    if (!Compression::Decompress(compressed.Codec, *compressed.Compressed, image.data, ImageBytes(image)))
+    {
+        // The payload was made in this process, so this is a lost image rather than bad
+        // input: drop it like an eviction and let the producer compute it again
+        CV_LOG_ERROR(NULL, "Compressed image of output pin " << outputPinId << " is corrupt, recomputing it");
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stats.DecompressionFailures++;
+        auto it = m_ImageData.find(outputPinId);
+        if (it != m_ImageData.end() && it->second.Compressed == compressed.Compressed)
+        {
+            m_ImageData.erase(it);
+            m_LostOutputPins.push_back(outputPinId);
+        }
+        return cv::Mat();
+    }
+
+    // Hot again: keep it decompressed until it goes cold once more. If the pin was
+    // republished or another reader got there first, this copy only serves this read.
+    cv::Mat previous;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats.Decompressions++;
+    auto it = m_ImageData.find(outputPinId);
+    if (it != m_ImageData.end() && it->second.Compressed == compressed.Compressed)
+    {
+        ImageEntry& entry = it->second;
+        previous = entry.Image;
+        entry.Image = image;
+        entry.Codec = Compression::Codec::None;
+        entry.Compressed.reset();
+    }
+    return image;
+}
+
+void ImageDataManager::AgeImages()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    for (auto& entry : m_ImageData)
+        entry.second.IdleEvaluations++;
+}
+
+std::vector<uint64_t> ImageDataManager::GetColdOutputPins(int evaluations) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<uint64_t> pins;
+    for (const auto& entry : m_ImageData)
+    {
+        if (entry.second.IdleEvaluations >= evaluations && entry.second.Codec == Compression::Codec::None &&
+            !entry.second.Incompressible)
+            pins.push_back(entry.first);
+    }
+    return pins;
+}
+
+bool ImageDataManager::CompressImage(uint64_t outputPinId)
+{
+    cv::Mat image;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_ImageData.find(outputPinId);
+        if (it == m_ImageData.end() || it->second.Codec != Compression::Codec::None)
+            return false;
+        image = it->second.Image;
+    }
+
+    // Images paged to scratch files take no memory while cold, compressing them would
+    if (BufferPool::GetInstance().IsMapped(image.u))
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_ImageData.find(outputPinId);
+        if (it != m_ImageData.end())
+            it->second.Incompressible = true;
+        return false;
+    }
+
+    // Compressing only frees memory if the pin is the sole owner of the buffer (this
+    // copy aside). Submatrices are left alone. Either may change, retry once cold again.
+    if (image.empty() || !image.isContinuous() || !image.u || image.u->refcount > 2 || image.u->size != ImageBytes(image))
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_ImageData.find(outputPinId);
+        if (it != m_ImageData.end())
+            it->second.IdleEvaluations = 0;
+        return false;
+    }
+
+    // Masks and flat single channels are runs of equal bytes. Anything else, or masks
+    // that do not compress to half, get the LZ codec. Less than a quarter saved is not
+    // worth the decompression.
+    const size_t size = ImageBytes(image);
+    std::vector<uint8_t> compressed;
+    Compression::Codec codec = Compression::Codec::None;
+    if (image.type() == CV_8UC1 && Compression::CompressRunLength(image.data, size, size / 2, compressed))
+        codec = Compression::Codec::RunLength;
+    else if (Compression::CompressLz(image.data, size, size - size / 4, compressed))
+        codec = Compression::Codec::Lz;
+    compressed.shrink_to_fit();
+
+    cv::Mat previous;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto it = m_ImageData.find(outputPinId);
+    if (it == m_ImageData.end() || it->second.Image.data != image.data || image.u->refcount > 2)
+        return false; // Replaced or read meanwhile
+
+    if (codec == Compression::Codec::None)
+    {
+        it->second.Incompressible = true;
+        return false;
+    }
+
+    ImageEntry& entry = it->second;
+    entry.Size = image.size();
+    entry.Type = image.type();
+    entry.Codec = codec;
+    entry.Compressed = std::make_shared<const std::vector<uint8_t>>(std::move(compressed));
+    previous = entry.Image;
+    entry.Image = cv::Mat();
+    return true;
+}
+
+std::vector<uint64_t> ImageDataManager::TakeLostOutputPins()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::vector<uint64_t> pins;
+    pins.swap(m_LostOutputPins);
+    return pins;
+}
+
+ImageDataStats ImageDataManager::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ImageDataStats stats = m_Stats;
+    for (const auto& entry : m_ImageData)
+    {
+        // Half precision takes half of what single precision would
+        const int type = entry.second.Codec == Compression::Codec::None ? entry.second.Image.type() : entry.second.Type;
+        if (CV_MAT_DEPTH(type) == CV_16F)
+        {
+            stats.HalfPrecisionImages++;
+            stats.HalfPrecisionBytesSaved += entry.second.Codec == Compression::Codec::None ?
+                ImageBytes(entry.second.Image) : (size_t)entry.second.Size.area() * CV_ELEM_SIZE(type);
+        }
+
+        if (entry.second.Codec == Compression::Codec::None)
+            continue;
+        stats.CompressedImages++;
+        stats.CompressedBytes += entry.second.Compressed->size();
+        stats.UncompressedBytes += (size_t)entry.second.Size.area() * CV_ELEM_SIZE(entry.second.Type);
+    }
+    return stats;
+}
+
+void ImageDataManager::ResetStats()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Stats = ImageDataStats();
 }
 
 void ImageDataManager::Clear()
 {
-    // Clear all stored image data and connections
+    // Clear all stored image data, connections and versions
+    // (m_LastVersion keeps counting so versions are never reused)
+    std::lock_guard<std::mutex> lock(m_Mutex);
     m_ImageData.clear();
     m_Connections.clear();
+    m_Versions.clear();
+    m_LostOutputPins.clear();
 }
 
 void ImageDataManager::UpdateConnections(const std::vector<Link*>& links)
 {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
     // Clear existing connections
     m_Connections.clear();
     
@@ -2,10 +2,52 @@
 
 #include <opencv2/opencv.hpp>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <mutex>
+#include <memory>
 #include "NodeEditorManager.h"
+#include "Compression.h"
 
-// This class manages the image data flow between nodes
+// Counters describing how image buffers moved between nodes
+struct ImageDataStats {
+    uint64_t SharedHandoffs = 0;  // Images published or read as a view of the producer's buffer.
+    uint64_t SharedBytes = 0;     // Their size. Before sharing, each publish and each read cloned it.
+    int CompressedImages = 0;     // Cold images currently held compressed
+    size_t CompressedBytes = 0;   // Memory they take compressed...
+    size_t UncompressedBytes = 0; // ...and would take uncompressed
+    uint64_t Decompressions = 0;  // Compressed images read again
+    uint64_t DecompressionFailures = 0; // Corrupt payloads read, dropped like an eviction
+    int HalfPrecisionImages = 0;  // Float images currently stored in half precision
+    size_t HalfPrecisionBytesSaved = 0; // Memory that saves over single precision
+    uint64_t HalfPrecisionRejected = 0; // Float images kept in single precision, out of half range
+    uint64_t HalfPrecisionDecodes = 0;  // Half precision images converted back for a reader
+    double MaxHalfPrecisionError = 0.0; // Largest relative round-trip error measured, see SetHalfPrecisionCheck
+};
+
+// Memory held for one output pin
+struct PinMemoryUsage {
+    size_t Bytes = 0;           // Buffer size, or compressed size
+    bool HalfPrecision = false; // Float image stored in half precision
+    bool Compressed = false;
+    bool Mapped = false;        // Backed by a scratch file, see BufferPool
+};
+
+// This class manages the image data flow between nodes.
+//
+// Buffers are shared, never cloned: a producer publishes its cv::Mat (which is
+// reference counted by OpenCV) and every consumer receives a header that views
+// the same pixels. Published images are therefore read-only: producers always
+// write results into freshly allocated Mats and consumers never modify their inputs.
+//
+// Half precision storage. With SetHalfPrecisionStorage() on, single precision float
+// images are stored as CV_16F and converted back to CV_32F for every reader, so nodes
+// still compute in single precision while their intermediates take half the memory.
+// A CV_16F image on a pin therefore always means "half precision copy of a CV_32F
+// image" - nodes never publish CV_16F themselves.
+//
+// All methods are thread-safe; nodes running on the evaluation thread pool
+// publish and read images concurrently.
 class ImageDataManager {
 public:
     static ImageDataManager& GetInstance() {
@@ -13,25 +55,120 @@ public:
         return instance;
     }
 
-    // Set image data for a pin
+    // Publish image data for an output pin (shares the buffer, no copy)
     void SetImageData(ed::PinId outputPinId, const cv::Mat& image);
 
-    // Get image data from a pin
+    // Get a read-only view of the image connected to an input pin
     cv::Mat GetImageData(ed::PinId inputPinId);
 
+    // The image published on an output pin as stored, CV_16F for half precision
+    // storage. For keeping results without converting them.
+    cv::Mat GetStoredData(ed::PinId outputPinId);
+
+    // Remove the image published on an output pin
+    void ClearImageData(ed::PinId outputPinId);
+
+    // Data versions. Every time a node re-runs its output pins get a new version
+    // drawn from one global counter, so versions are unique across pins and an
+    // input that is re-linked to a different source also sees a different version.
+    uint64_t BumpVersion(ed::PinId outputPinId);
+    uint64_t GetVersion(ed::PinId outputPinId) const;
+    uint64_t GetInputVersion(ed::PinId inputPinId) const; // 0 if the input is unconnected
+
     // Clear all image data (e.g., when resetting the editor)
     void Clear();
 
     // Update connections based on links in the editor
     void UpdateConnections(const std::vector<Link*>& links);
 
+    // Memory held by published images and by 'heldImages' (those nodes keep on their
+    // own), each buffer counted once however many pins and nodes share it. Images
+    // backed by scratch files are paged by the OS and not counted.
+    // Pins are listed least recently published or read first, for eviction under a
+    // memory budget (see NodeEditorManager::EnforceMemoryBudget).
+    size_t GetMemoryUsage(const std::vector<cv::Mat>& heldImages) const;
+    std::vector<uint64_t> GetOutputPinsByLastUse() const;
+
+    // Cold images. Every finished evaluation ages the images it did not publish or read;
+    // those idle for 'evaluations' evaluations are cold. CompressImage() replaces a cold
+    // image with a lossless compressed copy if nothing else holds its buffer, and the
+    // next read decompresses it again. Compression runs outside the lock and is dropped
+    // if the image is published or shared meanwhile.
+    void AgeImages();
+    std::vector<uint64_t> GetColdOutputPins(int evaluations) const;
+    bool CompressImage(uint64_t outputPinId);
+    // Output pins whose compressed image could not be decompressed. Their images were
+    // dropped and read as empty, the caller recomputes them as if evicted.
+    std::vector<uint64_t> TakeLostOutputPins();
+
+    // Memory held for an output pin, shared buffers counted for every pin holding them
+    PinMemoryUsage GetPinMemoryUsage(ed::PinId outputPinId) const;
+
+    // Store single precision float images published from now on in half precision.
+    // Images with values beyond the half range (+-65504), infinities or NaNs stay in
+    // single precision; for the others the relative error of every value is at most
+    // HalfPrecisionErrorBound, or that times 2^-14 in absolute terms below 2^-14.
+    void SetHalfPrecisionStorage(bool enabled);
+    bool GetHalfPrecisionStorage() const;
+    // Measure the round-trip error of every image stored in half precision, for
+    // ImageDataStats::MaxHalfPrecisionError. Costs one more conversion per image.
+    void SetHalfPrecisionCheck(bool enabled);
+    bool GetHalfPrecisionCheck() const;
+
+    static constexpr double HalfPrecisionErrorBound = 1.0 / 2048; // 2^-11, half an ulp of a 10-bit mantissa
+
+    // Buffer hand-off statistics
+    ImageDataStats GetStats() const;
+    void ResetStats();
+
 private:
     ImageDataManager() = default;
     ~ImageDataManager() = default;
 
+    uint64_t GetVersionLocked(uint64_t outputPinId) const;
+
+    // Guards every member below
+    mutable std::mutex m_Mutex;
+
+    struct ImageEntry {
+        cv::Mat Image;
+        uint64_t LastUse = 0; // Value of m_UseCounter when last published or read
+        int IdleEvaluations = 0; // Evaluations since then, see AgeImages()
+        bool Incompressible = false; // Compression was tried and saved too little
+        // Compressed copy while Image is empty
+        Compression::Codec Codec = Compression::Codec::None;
+        std::shared_ptr<const std::vector<uint8_t>> Compressed;
+        cv::Size Size;
+        int Type = 0;
+    };
+
+    // Marks 'entry' as used and returns its image. A compressed entry returns an empty
+    // Mat and hands its payload to 'compressed' for DecompressImage(). Requires m_Mutex.
+    cv::Mat GetImageLocked(ImageEntry& entry, ImageEntry& compressed);
+    // Decompresses a payload taken by GetImageLocked() without holding m_Mutex, and
+    // keeps the result if the pin still holds that payload. A corrupt payload is
+    // dropped and reported by TakeLostOutputPins(), the read returns an empty Mat.
+    cv::Mat DecompressImage(uint64_t outputPinId, const ImageEntry& compressed);
+    // Converts an image read from a pin back to single precision if it is stored in
+    // half precision. Called without m_Mutex.
+    cv::Mat ToSinglePrecision(const cv::Mat& image);
+    // The half precision copy of a single precision image, empty if out of range
+    cv::Mat ToHalfPrecision(const cv::Mat& image);
+
     // Maps output pin IDs to the image data they produce
-    std::unordered_map<uint64_t, cv::Mat> m_ImageData;
+    std::unordered_map<uint64_t, ImageEntry> m_ImageData;
+    uint64_t m_UseCounter = 0;
+    std::vector<uint64_t> m_LostOutputPins; // See TakeLostOutputPins()
 
     // Maps input pin IDs to the output pin IDs they're connected to
     std::unordered_map<uint64_t, uint64_t> m_Connections;
+
+    // Maps output pin IDs to the version of the data they currently hold
+    std::unordered_map<uint64_t, uint64_t> m_Versions;
+    uint64_t m_LastVersion = 0;
+
+    bool m_HalfPrecision = false;
+    bool m_HalfPrecisionCheck = false;
+
+    ImageDataStats m_Stats;
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+
+// Ring buffer holding the most recent rows of an image that is produced one row at
+// a time, as used by streamed evaluation (NodeEditorManager::StreamChain).
+//
+// Every row is stored twice, 'capacity' rows apart, so any window of up to
+// 'capacity' recent rows is contiguous in memory and can be handed to OpenCV as a
+// cv::Mat without copying.
+class LineBuffer {
+public:
+    void Create(int capacity, int cols, int type)
+    {
+        m_Capacity = capacity;
+        m_RowsPushed = 0;
+        m_Storage.create(2 * capacity, cols, type);
+    }
+
+    bool Empty() const { return m_Storage.empty(); }
+    int RowsPushed() const { return m_RowsPushed; }
+    size_t GetSizeInBytes() const { return m_Storage.empty() ? 0 : m_Storage.total() * m_Storage.elemSize(); }
+
+    // Appends the next row of the image (a single row of the type given to Create())
+    void PushRow(const cv::Mat& row)
+    {
+        const int slot = m_RowsPushed % m_Capacity;
+        cv::Mat first = m_Storage.row(slot);
+        cv::Mat second = m_Storage.row(slot + m_Capacity);
+        row.copyTo(first);
+        row.copyTo(second);
+        m_RowsPushed++;
+    }
+
+    // Rows [firstRow, endRow) of the image. They must be among the last 'capacity' rows
+    // pushed. The result is a standalone header, not a submatrix of the storage: filters
+    // treat its first and last rows as the image border.
+    cv::Mat Window(int firstRow, int endRow) const
+    {
+        CV_Assert(firstRow >= std::max(0, m_RowsPushed - m_Capacity) && endRow <= m_RowsPushed && endRow - firstRow <= m_Capacity);
+        const int slot = firstRow % m_Capacity;
+        return cv::Mat(endRow - firstRow, m_Storage.cols, m_Storage.type(),
+            const_cast<uchar*>(m_Storage.ptr(slot)), m_Storage.step);
+    }
+
+private:
+    cv::Mat m_Storage;
+    int m_Capacity = 0;
+    int m_RowsPushed = 0;
+};
@@ -0,0 +1,56 @@
+#include "MappedBuffer.h"
+#include <Windows.h>
+
+std::unique_ptr<MappedBuffer> MappedBuffer::Create(const std::string& directory, size_t bytes)
+{
+    std::string folder = directory;
+    if (folder.empty())
+    {
+        char tempPath[MAX_PATH];
+        const DWORD length = GetTempPathA(MAX_PATH, tempPath);
+        if (length == 0 || length > MAX_PATH)
+            return nullptr;
+        folder = tempPath;
+    }
+
+    // GetTempFileName creates an empty file with a unique name, reopened here so that
+    // closing the last handle deletes it. Temporary files are only written out to disk
+    // when the cache manager needs the memory.
+    char path[MAX_PATH];
+    if (GetTempFileNameA(folder.c_str(), "nbi", 0, path) == 0)
+        return nullptr;
+
+    std::unique_ptr<MappedBuffer> buffer(new MappedBuffer());
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        DeleteFileA(path);
+        return nullptr;
+    }
+    buffer->m_File = file;
+
+    // A mapping larger than the file extends it, the new pages read as zeros. Mapped
+    // files are not charged against the commit limit, so the view may exceed RAM.
+    const uint64_t size = bytes;
+    buffer->m_Mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xffffffffu), nullptr);
+    if (!buffer->m_Mapping)
+        return nullptr;
+
+    buffer->m_Data = (unsigned char*)MapViewOfFile(buffer->m_Mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    if (!buffer->m_Data)
+        return nullptr;
+
+    buffer->m_Size = bytes;
+    return buffer;
+}
+
+MappedBuffer::~MappedBuffer()
+{
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping)
+        CloseHandle(m_Mapping);
+    if (m_File)
+        CloseHandle(m_File);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// A buffer backed by a temporary scratch file mapped into memory, for images larger
+// than RAM. The OS page cache keeps the pages in use resident, writes the others out
+// to the file when memory runs short, and reads them back in when they are touched
+// again. Evaluation walks images tile by tile or row band by row band, so only those
+// parts are resident at a time. The file is deleted with the buffer, or by the OS if
+// the process ends first.
+class MappedBuffer {
+public:
+    // Creates a zero-filled buffer of 'bytes' in 'directory' (the system temporary
+    // directory if empty). Returns nullptr if the file cannot be created or mapped.
+    static std::unique_ptr<MappedBuffer> Create(const std::string& directory, size_t bytes);
+    ~MappedBuffer();
+
+    MappedBuffer(const MappedBuffer&) = delete;
+    MappedBuffer& operator=(const MappedBuffer&) = delete;
+
+    unsigned char* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    MappedBuffer() = default;
+
+    void* m_File = nullptr;    // Scratch file handle
+    void* m_Mapping = nullptr; // File mapping handle
+    unsigned char* m_Data = nullptr;
+    size_t m_Size = 0;
+};
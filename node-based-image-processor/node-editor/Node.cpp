@@ -1,5 +1,6 @@
 #include "Node.h"
 #include "NodeEditorManager.h"
+#include "ImageDataManager.h"
 #include "nodes/InputNode.h"
 #include "nodes/OutputNode.h"
 #include "nodes/BrightnessContrastNode.h"
@@ -10,10 +11,11 @@
 #include "nodes/EdgeDetectionNode.h"
 #include "nodes/ConvolutionFilterNode.h"
 #include "nodes/NoiseGenerationNode.h"
+#include <cstring>
 
 // Pin implementation
-Pin::Pin(int id, const char* name, PinType type, PinKind kind)
-    : ID(id), Node(nullptr), Name(name), Type(type), Kind(kind)
+Pin::Pin(uint64_t id, const char* name, PinType type, PinKind kind)
+    : ID((uintptr_t)id), Node(nullptr), Name(name), Type(type), Kind(kind)
 {
 }
 
@@ -44,9 +46,272 @@ ImColor Pin::GetColor() const
 }
 
 // Node implementation
+uint64_t Node::s_ChangeCount = 0;
+
 Node::Node(int id, const char* name, ImColor color)
-    : ID(id), Name(name), Color(color), Size(0, 0), Dirty(true)
+    : ID(id), Name(name), Color(color), Size(0, 0)
+{
+    s_ChangeCount++; // A new node is dirty
+}
+
+void Node::SetDirty(bool dirty)
+{
+    // Clearing the flag never makes work, only setting it does
+    if (dirty)
+        s_ChangeCount++;
+    m_Dirty = dirty;
+}
+
+void Node::SetOnScreen(bool onScreen)
+{
+    // Called every frame, only an actual change counts
+    if (onScreen != m_OnScreen)
+        s_ChangeCount++;
+    m_OnScreen = onScreen;
+}
+
+void Node::DrawPreviewCheckbox(const char* label)
+{
+    if (ImGui::Checkbox(label, &m_ShowPreview))
+        s_ChangeCount++;
+}
+
+void Node::CaptureParameters()
+{
+    // Default implementation does nothing
+}
+
+void Node::PreparePreview()
+{
+    m_PreviewImage = MakePreviewImage(m_OutputImage);
+}
+
+void Node::UpdatePreview()
+{
+    // Default implementation does nothing
+}
+
+void Node::ScaleParameters(double /*scale*/)
+{
+    // Default implementation does nothing, the parameters don't depend on the resolution
+}
+
+int Node::GetInputHalo() const
+{
+    // Needs the whole image unless the node opts in to tiled evaluation
+    return -1;
+}
+
+void Node::ProcessTile(const cv::Mat& /*input*/, cv::Mat& /*output*/) const
+{
+    // Only called for nodes that report an input halo
+}
+
+void Node::ProcessSideTile(const cv::Mat& input, const std::vector<cv::Mat>& /*sideInputs*/, cv::Mat& output) const
+{
+    ProcessTile(input, output);
+}
+
+void Node::SetTiledResult(const cv::Mat& /*input*/, const cv::Mat& output)
+{
+    m_OutputImage = output;
+    if (!Outputs.empty())
+        ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
+}
+
+bool Node::RequestsRegion() const
+{
+    return false;
+}
+
+bool Node::GetRequestedRegion(const cv::Size& /*inputSize*/, cv::Rect& /*region*/) const
+{
+    return false;
+}
+
+void Node::SetRegionResult(const cv::Mat& /*region*/)
+{
+    // Only called for nodes that request a region
+}
+
+void Node::SetStreamedResult(const cv::Mat& preview)
+{
+    // Only drawn by the node itself, consumers see no data on the output pin
+    m_OutputImage = preview;
+}
+
+void Node::ReleaseResults()
+{
+    // cv::resize has no half precision support
+    cv::Mat display = m_DisplayImage;
+    if (display.depth() == CV_16F)
+        display.convertTo(display, CV_32F);
+
+    cv::Mat preview;
+    const int longestSide = std::max(display.cols, display.rows);
+    if (longestSide > PreviewMaxSize)
+    {
+        const double scale = (double)PreviewMaxSize / longestSide;
+        cv::resize(display, preview, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    else
+    {
+        preview = display;
+    }
+
+    m_OutputImage = preview;
+    m_DisplayImage = preview;
+    ReleaseInputs();
+}
+
+void Node::ReleaseInputs()
+{
+    // Default implementation does nothing, the node keeps no inputs
+}
+
+void Node::GetHeldImages(std::vector<cv::Mat>& images) const
+{
+    images.push_back(m_OutputImage);
+    images.push_back(m_DisplayImage);
+    images.push_back(m_PreviewImage);
+}
+
+bool Node::IsGraphOutput() const
+{
+    return false;
+}
+
+bool Node::IsPreviewShown() const
+{
+    return m_ShowPreview;
+}
+
+bool Node::GetParameterHash(size_t& /*hash*/) const
+{
+    // Nodes with state of their own (a loaded image, random noise) are never merged
+    return false;
+}
+
+bool Node::GetResultHash(size_t& hash) const
+{
+    return GetParameterHash(hash);
+}
+
+void Node::SaveResults(NodeResults& results) const
+{
+    // Published images are never modified, so the buffers can be shared as they are
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    results.Outputs.clear();
+    for (auto& output : Outputs)
+        results.Outputs.push_back(dataManager.GetStoredData(output.ID));
+    results.OutputImage = GetStoredOutputImage();
+    results.PreviewImage = m_PreviewImage;
+}
+
+void Node::LoadResults(const NodeResults& results)
+{
+    m_OutputImage = results.OutputImage;
+    m_PreviewImage = results.PreviewImage;
+
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    for (size_t i = 0; i < Outputs.size() && i < results.Outputs.size(); i++)
+        dataManager.SetImageData(Outputs[i].ID, results.Outputs[i]);
+}
+
+void Node::ShareResults(const Node& source)
+{
+    NodeResults results;
+    source.SaveResults(results);
+    LoadResults(results);
+}
+
+size_t NodeResults::GetSizeInBytes() const
+{
+    size_t bytes = OutputImage.total() * OutputImage.elemSize() + PreviewImage.total() * PreviewImage.elemSize();
+    for (const cv::Mat& image : Outputs)
+        bytes += image.total() * image.elemSize();
+    for (const cv::Mat& image : Extra)
+        bytes += image.total() * image.elemSize();
+    return bytes;
+}
+
+size_t Node::HashImage(const cv::Mat& image)
+{
+    size_t hash = 0;
+    HashCombine(hash, image.rows);
+    HashCombine(hash, image.cols);
+    HashCombine(hash, image.type());
+
+    // FNV-1a over 8-byte words, row by row (rows of a submatrix are not contiguous)
+    uint64_t state = 0xcbf29ce484222325ull;
+    const size_t rowBytes = image.cols * image.elemSize();
+    for (int y = 0; y < image.rows; y++)
+    {
+        const uchar* row = image.ptr(y);
+        size_t x = 0;
+        for (; x + sizeof(uint64_t) <= rowBytes; x += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, row + x, sizeof(word));
+            state = (state ^ word) * 0x100000001b3ull;
+        }
+        for (; x < rowBytes; x++)
+            state = (state ^ row[x]) * 0x100000001b3ull;
+    }
+
+    HashCombine(hash, state);
+    return hash;
+}
+
+cv::Mat Node::GetStoredOutputImage() const
+{
+    if (m_OutputImage.depth() != CV_32F || Outputs.empty())
+        return m_OutputImage;
+
+    cv::Mat stored = ImageDataManager::GetInstance().GetStoredData(Outputs[0].ID);
+    if (stored.depth() == CV_16F && stored.size() == m_OutputImage.size() && stored.channels() == m_OutputImage.channels())
+        return stored;
+    return m_OutputImage;
+}
+
+void Node::PublishResults()
 {
+    // With half precision storage the node keeps the stored copy of its output rather
+    // than its own single precision one. The preview was made from the full precision
+    // output already. Its inputs are dropped either way: the producers' buffers (or the
+    // single precision copies of them) must not outlive the producers' own references.
+    m_OutputImage = GetStoredOutputImage();
+    m_DisplayImage = m_OutputImage;
+    UpdatePreview();
+    ReleaseInputs();
+}
+
+cv::Mat Node::MakePreviewImage(const cv::Mat& image)
+{
+    if (image.empty())
+        return cv::Mat();
+
+    // Previews are drawn a few hundred pixels wide, uploading more than that is wasted work
+    cv::Mat scaled = image;
+    int longestSide = std::max(image.cols, image.rows);
+    if (longestSide > PreviewMaxSize)
+    {
+        double scale = (double)PreviewMaxSize / longestSide;
+        cv::resize(image, scaled, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+
+    // Convert image from OpenCV BGR format to RGBA for OpenGL
+    cv::Mat rgbaImage;
+    if (scaled.channels() == 3)
+        cv::cvtColor(scaled, rgbaImage, cv::COLOR_BGR2RGBA);
+    else if (scaled.channels() == 4)
+        cv::cvtColor(scaled, rgbaImage, cv::COLOR_BGRA2RGBA);
+    else if (scaled.channels() == 1)
+        cv::cvtColor(scaled, rgbaImage, cv::COLOR_GRAY2RGBA);
+    else
+        rgbaImage = scaled.clone(); // Just use as-is if format is unexpected
+
+    return rgbaImage;
 }
 
 void Node::OnSelected()
@@ -61,33 +326,28 @@ void Node::OnDeselected()
 
 void Node::AddInputPin(const char* name, PinType type)
 {
-    int pinID = 1000000 * (int)ID.Get() + 1000 + NextInputPinIndex++; // 1000 block for inputs
+    uint64_t pinID = PinIdLayout::Make((uint64_t)ID.Get(), PinKind::Input, NextInputPinIndex++);
     Inputs.emplace_back(pinID, name, type, PinKind::Input);
     Inputs.back().Node = this;
 }
 
 void Node::AddOutputPin(const char* name, PinType type)
 {
-    int pinID = 1000000 * (int)ID.Get() + 2000 + NextOutputPinIndex++; // 2000 block for outputs
+    uint64_t pinID = PinIdLayout::Make((uint64_t)ID.Get(), PinKind::Output, NextOutputPinIndex++);
     Outputs.emplace_back(pinID, name, type, PinKind::Output);
     Outputs.back().Node = this;
 }
 
 Pin* Node::FindPin(ed::PinId id)
 {
-    // Search in inputs
-    for (auto& pin : Inputs)
-    {
-        if (pin.ID == id)
-            return &pin;
-    }
-    
-    // Search in outputs
-    for (auto& pin : Outputs)
-    {
-        if (pin.ID == id)
-            return &pin;
-    }
+    // The pin ID encodes its owner, kind and index
+    if (PinIdLayout::NodeId(id) != (uint64_t)ID.Get())
+        return nullptr;
+
+    auto& pins = (PinIdLayout::Kind(id) == PinKind::Input) ? Inputs : Outputs;
+    int index = PinIdLayout::Index(id);
+    if (index < (int)pins.size() && pins[index].ID == id)
+        return &pins[index];
     
     return nullptr;
 }
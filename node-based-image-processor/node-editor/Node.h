@@ -2,9 +2,12 @@
 
 #include <imgui_node_editor.h>
 #include <opencv2/opencv.hpp>
+#include "EvaluationContext.h"
 #include <string>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <functional>
 
 namespace ed = ax::NodeEditor;
 
@@ -29,10 +32,32 @@ enum class PinKind {
     Output
 };
 
+// Pin IDs are 64-bit and encode their owner, so a pin can be resolved without any search:
+//   bits 63..17 : ID of the owning node
+//   bit  16     : pin kind (0 = input, 1 = output)
+//   bits 15..0  : index of the pin in the node's Inputs/Outputs
+namespace PinIdLayout {
+    constexpr int IndexBits = 16;
+    constexpr uint64_t IndexMask = (1ull << IndexBits) - 1;
+    constexpr uint64_t KindBit = 1ull << IndexBits;
+    constexpr int NodeShift = IndexBits + 1;
+
+    inline uint64_t Make(uint64_t nodeId, PinKind kind, int index)
+    {
+        return (nodeId << NodeShift) | (kind == PinKind::Output ? KindBit : 0) | ((uint64_t)index & IndexMask);
+    }
+
+    inline uint64_t NodeId(ed::PinId id) { return (uint64_t)id.Get() >> NodeShift; }
+    inline PinKind Kind(ed::PinId id) { return ((uint64_t)id.Get() & KindBit) ? PinKind::Output : PinKind::Input; }
+    inline int Index(ed::PinId id) { return (int)((uint64_t)id.Get() & IndexMask); }
+}
+
+static_assert(sizeof(uintptr_t) == sizeof(uint64_t), "Pin IDs require 64-bit editor IDs");
+
 // Pin class for inputs/outputs
 class Pin {
 public:
-    Pin(int id, const char* name, PinType type, PinKind kind);
+    Pin(uint64_t id, const char* name, PinType type, PinKind kind);
     virtual ~Pin() = default;
 
     ed::PinId ID;
@@ -40,11 +65,24 @@ public:
     std::string Name;
     PinType Type;
     PinKind Kind;
+    uint64_t ConsumedVersion = 0; // Input pins: data version read by the last Process() call
     
     bool IsConnected() const; // Checks with NodeEditorManager if this pin is connected
     ImColor GetColor() const;
 };
 
+// What a node keeps from one evaluation, copied out of it to be taken over by another
+// node or by a later evaluation (see Node::SaveResults). Images are shared, not cloned.
+struct NodeResults {
+    std::vector<cv::Mat> Outputs; // Images published on the output pins
+    cv::Mat OutputImage;
+    cv::Mat PreviewImage;
+    std::vector<cv::Mat> Extra;   // Node specific images (ThresholdNode's histogram)
+    std::vector<double> Values;   // Node specific numbers
+
+    size_t GetSizeInBytes() const;
+};
+
 // Base Node class
 class Node {
 public:
@@ -52,18 +90,133 @@ public:
     virtual ~Node() = default;
 
     // Virtual methods for node operations
-    virtual void Process() = 0;
+    // Process() runs on the evaluation threads while the UI keeps drawing. It must only
+    // read the parameter snapshot taken by CaptureParameters(), write the node's own
+    // results and ImageDataManager - never ImGui, the renderer or the UI-side parameters.
+    // Long-running work should stop early once context.IsCancelled() returns true.
+    virtual void Process(const EvaluationContext& context) = 0;
     virtual void DrawNodeContent() = 0;
+    // Called on the UI thread when an evaluation that will run this node is started.
+    // Copies the parameters edited by DrawNodeContent() into the snapshot Process() reads.
+    virtual void CaptureParameters();
+    // Called right after CaptureParameters() when the evaluation runs on proxies of the
+    // inputs, downscaled by 'scale' (< 1). Nodes with parameters in pixels (radii, block
+    // sizes, image sizes) scale their snapshot so the proxy result looks like the full one.
+    virtual void ScaleParameters(double scale);
+    // Called on the evaluation thread right after Process(), converts the results into
+    // small RGBA images so the UI thread only has to upload them
+    virtual void PreparePreview();
+    // Called on the UI thread once the evaluation finished, to refresh preview textures
+    virtual void UpdatePreview();
+
+    // Tiled evaluation. A node with one image input and one image output that computes
+    // every output pixel from a small neighborhood of the same input pixel reports how
+    // far that neighborhood reaches (0 for pointwise operations). Chains of such nodes
+    // are evaluated tile by tile instead of calling Process(), see
+    // NodeEditorManager::EvaluateChain(). -1 means the node needs the whole image.
+    // Pointwise nodes may have more image inputs, see ProcessSideTile().
+    virtual int GetInputHalo() const;
+    // Computes the output for the region 'input' covers. 'input' is a submatrix of a
+    // larger image that extends GetInputHalo() pixels beyond it, or ends at the image
+    // border. Runs concurrently for different tiles, so it must not modify the node.
+    virtual void ProcessTile(const cv::Mat& input, cv::Mat& output) const;
+    // ProcessTile() for pointwise nodes with more than one image input: 'input' is the
+    // tile of the first one, 'sideInputs' the same region of the others, as published
+    virtual void ProcessSideTile(const cv::Mat& input, const std::vector<cv::Mat>& sideInputs, cv::Mat& output) const;
+    // Takes over the full result of a tiled evaluation, in place of Process()
+    virtual void SetTiledResult(const cv::Mat& input, const cv::Mat& output);
+    // Demand-driven evaluation. A node with one image input that only uses part of it
+    // (OutputNode inspecting at 1:1) requests that region, and the tileable nodes feeding
+    // it compute only the pixels needed for it, see NodeEditorManager::EvaluateRegion().
+    virtual bool RequestsRegion() const;
+    // The requested rectangle for an input of the given size, false for the whole image
+    virtual bool GetRequestedRegion(const cv::Size& inputSize, cv::Rect& region) const;
+    // Receives the requested region of the input, computed in place of Process()
+    virtual void SetRegionResult(const cv::Mat& region);
+    // Streamed evaluation never holds the full output of the inner nodes of a chain.
+    // They only get a downscaled copy of it, for their preview, and publish no data.
+    virtual void SetStreamedResult(const cv::Mat& preview);
+    // Called on the UI thread when the node's outputs are evicted to fit the memory budget.
+    // Like a streamed node, it keeps a downscaled copy for its preview and drops every full
+    // size image it holds, including its references to its inputs.
+    virtual void ReleaseResults();
+    // Drops the node's references to its input images, which Process() is done with.
+    // Called by ReleaseResults() and PublishResults(): a consumer holding its input would
+    // keep the producer's buffer alive after the producer was evicted.
+    virtual void ReleaseInputs();
+    // Appends every image the node holds on to, for the memory usage (see
+    // NodeEditorManager::EnforceMemoryBudget). Nodes keeping more than their output,
+    // display and preview images add theirs.
+    virtual void GetHeldImages(std::vector<cv::Mat>& images) const;
+
+    // Longest side of the images made by MakePreviewImage()
+    static constexpr int PreviewMaxSize = 512;
+
+    // Liveness. Only nodes that feed a graph output or a preview on screen are
+    // evaluated, see NodeEditorManager::UpdateLiveness().
+    virtual bool IsGraphOutput() const;
+    virtual bool IsPreviewShown() const;
+
+    // Common subexpression elimination. A node whose outputs only depend on its inputs
+    // and its parameters hashes its parameter snapshot and returns true. Identical nodes
+    // fed from the same pins are then evaluated once, see NodeEditorManager::StartEvaluation().
+    virtual bool GetParameterHash(size_t& hash) const;
+    // Identifies the results for given inputs, for the result cache: the parameter hash,
+    // or for source nodes a hash of the data they provide
+    virtual bool GetResultHash(size_t& hash) const;
+    // Hashing a large source takes long, so it happens off the UI thread. Called on the
+    // UI thread before an evaluation, returns the work that brings the hash up to date,
+    // to be run on a worker, or nothing if it is current or already being computed.
+    // The evaluation waits for it rather than evaluating uncached.
+    virtual std::function<void()> StartContentHash() { return nullptr; }
+    // Copies the results of the last evaluation out, or takes such a copy over in place
+    // of Process(). Nodes that show more than their output images add the rest.
+    virtual void SaveResults(NodeResults& results) const;
+    virtual void LoadResults(const NodeResults& results);
+    // Takes over the results of an identical node, in place of Process()
+    void ShareResults(const Node& source);
+
+    // Mixes 'value' into 'hash', for GetParameterHash()
+    template <typename T>
+    static void HashCombine(size_t& hash, const T& value)
+    {
+        hash ^= std::hash<T>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
     virtual void OnSelected();
     virtual void OnDeselected();
 
+    // Makes the results of a finished evaluation visible to DrawNodeContent() (UI thread)
+    void PublishResults();
+
     ed::NodeId ID;
     std::string Name;
     std::vector<Pin> Inputs;
     std::vector<Pin> Outputs;
     ImColor Color;
     ImVec2 Size;
-    bool Dirty;  // Flag to indicate if node needs reprocessing
+    std::atomic<bool> Computing{ false }; // An evaluation that refreshes this node is in flight
+    bool OutputStreamed = false; // The last evaluation streamed the output through, nothing was kept
+    bool OutputEvicted = false;  // Outputs dropped to fit the memory budget, recomputed once read again
+    ed::NodeId MergedInto = 0; // Identical node this one shares its results with, if any (UI thread)
+
+    // Outputs the evaluation needs, one bit per output pin: those linked to a live node,
+    // or all of them while the preview is shown. Process() may leave the others empty.
+    uint32_t RequestedOutputs = ~0u;
+    uint32_t ComputedOutputs = 0; // RequestedOutputs of the last completed Process()
+    std::atomic<uint32_t> CacheHits{ 0 };   // Evaluations served by the result cache
+    std::atomic<uint32_t> CacheMisses{ 0 }; // Evaluations that ran and filled it
+    size_t ResultKey = 0; // Result cache key of the results the node holds, 0 if none
+    bool IsOutputRequested(size_t index) const { return (RequestedOutputs >> index) & 1u; }
+
+    // Whether the node needs reprocessing, and whether it was inside the visible part of
+    // the canvas when last drawn (UI thread). Marking a node dirty, moving it on or off
+    // screen and toggling its preview advance GetChangeCount(), so a frame on which it
+    // did not advance can skip looking for work, see NodeEditorManager::ProcessNodes().
+    bool IsDirty() const { return m_Dirty; }
+    void SetDirty(bool dirty);
+    bool IsOnScreen() const { return m_OnScreen; }
+    void SetOnScreen(bool onScreen);
+    static uint64_t GetChangeCount() { return s_ChangeCount; }
 
     // Add pins
     void AddInputPin(const char* name, PinType type);
@@ -78,8 +231,28 @@ public:
     int NextOutputPinIndex = 0;
 
 protected:
-    // Cache for processed image data
+    // Results are double-buffered: Process() writes m_OutputImage (back buffer) while
+    // DrawNodeContent() keeps showing m_DisplayImage, the output of the last completed
+    // evaluation (front buffer). PublishResults() moves one to the other.
     cv::Mat m_OutputImage;
+    cv::Mat m_DisplayImage;
+    cv::Mat m_PreviewImage; // RGBA preview of m_OutputImage, made by PreparePreview()
+    bool m_ShowPreview = true; // "Show Preview" checkbox of the nodes that have one
+
+    // The "Show Preview" checkbox, which changes what is live
+    void DrawPreviewCheckbox(const char* label = "Show Preview");
+
+    // Convert an image to a downscaled RGBA copy for a preview texture
+    static cv::Mat MakePreviewImage(const cv::Mat& image);
+    // Hash of the size, type and pixels of an image
+    static size_t HashImage(const cv::Mat& image);
+    // m_OutputImage, or the half precision copy of it stored on the first output pin
+    cv::Mat GetStoredOutputImage() const;
+
+private:
+    bool m_Dirty = true;
+    bool m_OnScreen = true;
+    static uint64_t s_ChangeCount;
 };
 
 // Factory class to create specific node types
@@ -1,8 +1,37 @@
 #include "NodeEditorManager.h"
 #include "ImageDataManager.h"
-#include <queue>
-#include <set>
+#include "LineBuffer.h"
+#include "BufferPool.h"
+#include "ParallelBackend.h"
 #include <algorithm>
+#include <cstring>
+#include <typeindex>
+
+namespace {
+    // Size of the previews kept for nodes whose full output is never materialized
+    cv::Size GetPreviewSize(const cv::Size& imageSize)
+    {
+        const double scale = std::min(1.0, (double)Node::PreviewMaxSize / std::max(imageSize.width, imageSize.height));
+        return cv::Size(std::max(1, cvRound(imageSize.width * scale)), std::max(1, cvRound(imageSize.height * scale)));
+    }
+
+    // Runs a tileable node on 'input', the part of its first input around 'rect'. Its
+    // other inputs (pointwise nodes only) are cut to 'rect' as well.
+    void ProcessNodeTile(Node* node, const cv::Mat& input, const std::vector<cv::Mat>& sideImages, const cv::Rect& rect, cv::Mat& output)
+    {
+        if (sideImages.empty())
+        {
+            node->ProcessTile(input, output);
+            return;
+        }
+
+        std::vector<cv::Mat> sideTiles;
+        sideTiles.reserve(sideImages.size());
+        for (const cv::Mat& side : sideImages)
+            sideTiles.push_back(side(rect));
+        node->ProcessSideTile(input, sideTiles, output);
+    }
+}
 
 // Initialize the global pointer
 NodeEditorManager* g_NodeEditorManager = nullptr;
@@ -12,11 +41,15 @@ NodeEditorManager::NodeEditorManager()
 {
     // Set the global pointer to this instance
     g_NodeEditorManager = this;
+
+    // Evaluations run in the background on one pool, shared with OpenCV's own loops
+    SetThreadCount(0);
 }
 
 NodeEditorManager::~NodeEditorManager()
 {
     Shutdown();
+    ThreadPoolParallelBackend::Install(nullptr);
 
     // Clear the global pointer if it's pointing to this instance
     if (g_NodeEditorManager == this)
@@ -36,6 +69,12 @@ void NodeEditorManager::Initialize()
 
 void NodeEditorManager::Shutdown()
 {
+    // Nodes are about to go away, stop a running evaluation first
+    if (m_Evaluation)
+        m_Evaluation->Context.Cancel();
+    WaitForEvaluation();
+    m_ThreadPool->RunUntil([this] { return m_CompressionsInFlight.load() == 0 && m_ContentHashesInFlight.load() == 0; });
+
     if (m_EditorContext)
     {
         ed::DestroyEditor(m_EditorContext);
@@ -46,6 +85,12 @@ void NodeEditorManager::Shutdown()
     m_Links.clear();
     m_NodeMap.clear();
     m_LinkMap.clear();
+    m_PinLinks.clear();
+    m_NodeSuccessors.clear();
+    m_ExecutionPlan.clear();
+    m_StepOfNode.clear();
+    m_ResultCache.Clear();
+    InvalidatePlan();
 }
 
 void NodeEditorManager::Render()
@@ -72,16 +117,48 @@ void NodeEditorManager::Render()
         ImGui::EndTooltip();
     }
 
+    // The canvas fills this window. Its visible part decides which previews are on
+    // screen, and so which nodes are worth evaluating (see UpdateLiveness).
+    const ImVec2 windowMin = ImGui::GetWindowPos();
+    const ImVec2 windowMax(windowMin.x + ImGui::GetWindowWidth(), windowMin.y + ImGui::GetWindowHeight());
+
     // Begin the node editor canvas
     ed::Begin("Image Processing Editor");
 
+    const ImVec2 visibleMin = ed::ScreenToCanvas(windowMin);
+    const ImVec2 visibleMax = ed::ScreenToCanvas(windowMax);
+
     // Draw all nodes
     for (auto& node : m_Nodes)
     {
+        // Bounds from the last frame, good enough to tell whether the node is visible
+        const ImVec2 position = ed::GetNodePosition(node->ID);
+        const ImVec2 size = ed::GetNodeSize(node->ID);
+        node->SetOnScreen(position.x < visibleMax.x && position.x + size.x > visibleMin.x &&
+            position.y < visibleMax.y && position.y + size.y > visibleMin.y);
+
         ed::BeginNode(node->ID);
 
         // Node Title
         ImGui::Text("%s", node->Name.c_str());
+        if (node->Computing)
+        {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "(computing...)");
+        }
+        if (node->MergedInto)
+        {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.5f, 0.8f, 1.0f, 1.0f), "(merged)");
+            if (ImGui::IsItemHovered())
+            {
+                Node* canonical = FindNode(node->MergedInto);
+                ImGui::SetTooltip("Identical to %s #%d, its results are shared instead of computed twice",
+                    canonical ? canonical->Name.c_str() : "?", (int)node->MergedInto.Get());
+            }
+        }
+        if (node->CacheHits > 0 || node->CacheMisses > 0)
+            ImGui::TextDisabled("Cache: %u hits, %u misses", node->CacheHits.load(), node->CacheMisses.load());
         ImGui::Dummy(ImVec2(0, 5)); // Spacing after title
 
         // Horizontal layout for Pins Container
@@ -119,8 +196,7 @@ void NodeEditorManager::Render()
 
         // --- Spacer ---
         ImGui::Spring(1); // Push inputs left, outputs right
-        std::string temp = "                ";
-        ImGui::TextUnformatted(temp.c_str());
+        ImGui::TextUnformatted("                ");
 
         ImGui::Spring(2); // Push inputs left, outputs right
 
@@ -132,6 +208,14 @@ void NodeEditorManager::Render()
             ed::BeginPin(output.ID, ed::PinKind::Output);
             ImGui::BeginHorizontal(output.ID.AsPointer()); // Pin content horizontal layout
 
+            // Memory the pin's image takes
+            const PinMemoryUsage memory = ImageDataManager::GetInstance().GetPinMemoryUsage(output.ID);
+            if (memory.Bytes > 0)
+            {
+                ImGui::TextDisabled("%.1f MB%s%s%s", memory.Bytes / (1024.0 * 1024.0),
+                    memory.HalfPrecision ? " fp16" : "", memory.Compressed ? " packed" : "", memory.Mapped ? " mapped" : "");
+            }
+
             // Pin Name
             if (!output.Name.empty()) {
                 ImGui::TextUnformatted(output.Name.c_str());
@@ -182,14 +266,15 @@ void NodeEditorManager::Render()
 
 Node* NodeEditorManager::CreateNode(int nodeType, ImVec2 position)
 {
-    auto node = std::unique_ptr<Node>(NodeFactory::CreateNode(nodeType, GetNextId()));// taking ownership of raw pointer
+    auto node = std::shared_ptr<Node>(NodeFactory::CreateNode(nodeType, GetNextId()));// taking ownership of raw pointer
     if (!node)
         return nullptr;
 
     // Store node in our structures
     Node* nodePtr = node.get(); // Get raw pointer 
+    m_NodeMap[(uint64_t)nodePtr->ID.Get()] = NodeEntry{ nodePtr, m_Nodes.size() };
     m_Nodes.push_back(std::move(node)); // transfer ownership to vector 
-    m_NodeMap[(uint64_t)nodePtr->ID.Get()] = nodePtr;
+    InvalidatePlan();
 
     // Set node position - make sure editor context is set
     if (m_EditorContext) {
@@ -199,49 +284,54 @@ Node* NodeEditorManager::CreateNode(int nodeType, ImVec2 position)
     }
 
     // Mark as dirty to ensure it gets processed
-    nodePtr->Dirty = true;
+    nodePtr->SetDirty(true);
 
     return nodePtr;
 }
 
 void NodeEditorManager::DeleteNode(ed::NodeId id)
 {
-    auto it = std::find_if(m_Nodes.begin(), m_Nodes.end(),
-        [id](const std::unique_ptr<Node>& node) { return node->ID == id; });
+    auto it = m_NodeMap.find((uint64_t)id.Get());
+    if (it == m_NodeMap.end())
+        return;
+    Node* node = it->second.Ptr;
 
-    if (it != m_Nodes.end())
+    // Remove all links connected to this node (looked up through its pins)
+    auto linksToRemove = std::vector<ed::LinkId>();
+    for (auto* pins : { &node->Inputs, &node->Outputs })
     {
-        // Remove all links connected to this node
-        auto linksToRemove = std::vector<ed::LinkId>();
-        for (auto& link : m_Links)
+        for (auto& pin : *pins)
         {
-            auto startPin = FindPin(link->StartPinID);
-            auto endPin = FindPin(link->EndPinID);
-
-            if ((startPin && startPin->Node->ID == id) ||
-                (endPin && endPin->Node->ID == id))
-            {
+            for (auto* link : GetLinksForPin(pin.ID))
                 linksToRemove.push_back(link->ID);
-            }
-        }
-
-        for (auto linkId : linksToRemove)
-        {
-            DeleteLink(linkId);
         }
+    }
 
-        // Remove from map
-        m_NodeMap.erase((uint64_t)id.Get());
+    for (auto linkId : linksToRemove)
+    {
+        DeleteLink(linkId);
+    }
 
-        // Remove the node
-        m_Nodes.erase(it);
+    // Remove the node (a running evaluation keeps it alive until it finished). The
+    // last node takes its slot, no other node moves.
+    const size_t index = it->second.Index;
+    if (index + 1 != m_Nodes.size())
+    {
+        m_Nodes[index] = std::move(m_Nodes.back());
+        m_NodeMap[(uint64_t)m_Nodes[index]->ID.Get()].Index = index;
     }
+    m_Nodes.pop_back();
+
+    // Remove from maps
+    m_NodeMap.erase((uint64_t)id.Get());
+    m_NodeSuccessors.erase((uint64_t)id.Get());
+    InvalidatePlan();
 }
 
 Node* NodeEditorManager::FindNode(ed::NodeId id)
 {
     auto it = m_NodeMap.find((uint64_t)id.Get());
-    return (it != m_NodeMap.end()) ? it->second : nullptr;
+    return (it != m_NodeMap.end()) ? it->second.Ptr : nullptr;
 }
 
 Link* NodeEditorManager::CreateLink(Pin* output, Pin* input)
@@ -254,47 +344,56 @@ Link* NodeEditorManager::CreateLink(Pin* output, Pin* input)
     Link* linkPtr = link.get();
 
     // Store in our structures
+    m_LinkMap[(uint64_t)linkPtr->ID.Get()] = LinkEntry{ linkPtr, m_Links.size() };
     m_Links.push_back(std::move(link));
-    m_LinkMap[(uint64_t)linkPtr->ID.Get()] = linkPtr;
+    IndexLink(linkPtr);
+    InvalidatePlan();
 
     // Directly mark nodes as dirty
     if (output->Node)
-        output->Node->Dirty = true;
+        output->Node->SetDirty(true);
     if (input->Node)
-        input->Node->Dirty = true;
+        input->Node->SetDirty(true);
 
     return linkPtr;
 }
 
 void NodeEditorManager::DeleteLink(ed::LinkId id)
 {
-    auto it = std::find_if(m_Links.begin(), m_Links.end(),
-        [id](const std::unique_ptr<Link>& link) { return link->ID == id; });
+    auto it = m_LinkMap.find((uint64_t)id.Get());
+    if (it == m_LinkMap.end())
+        return;
+    Link* linkPtr = it->second.Ptr;
+    const size_t index = it->second.Index;
 
-    if (it != m_Links.end())
-    {
-        // Get pins connected by this link
-        auto startPin = FindPin((*it)->StartPinID);
-        auto endPin = FindPin((*it)->EndPinID);
+    // Get pins connected by this link
+    auto startPin = FindPin(linkPtr->StartPinID);
+    auto endPin = FindPin(linkPtr->EndPinID);
 
-        // Directly mark nodes as dirty
-        if (startPin && startPin->Node)
-            startPin->Node->Dirty = true;
-        if (endPin && endPin->Node)
-            endPin->Node->Dirty = true;
+    // Directly mark nodes as dirty
+    if (startPin && startPin->Node)
+        startPin->Node->SetDirty(true);
+    if (endPin && endPin->Node)
+        endPin->Node->SetDirty(true);
 
-        // Remove from map
-        m_LinkMap.erase((uint64_t)id.Get());
+    // Remove from maps
+    m_LinkMap.erase(it);
+    UnindexLink(linkPtr);
 
-        // Remove the link
-        m_Links.erase(it);
+    // Remove the link, the last one takes its slot
+    if (index + 1 != m_Links.size())
+    {
+        m_Links[index] = std::move(m_Links.back());
+        m_LinkMap[(uint64_t)m_Links[index]->ID.Get()].Index = index;
     }
+    m_Links.pop_back();
+    InvalidatePlan();
 }
 
 Link* NodeEditorManager::FindLink(ed::LinkId id)
 {
     auto it = m_LinkMap.find((uint64_t)id.Get());
-    return (it != m_LinkMap.end()) ? it->second : nullptr;
+    return (it != m_LinkMap.end()) ? it->second.Ptr : nullptr;
 }
 
 bool NodeEditorManager::IsLinkValid(Pin* output, Pin* input)
@@ -324,39 +423,62 @@ bool NodeEditorManager::IsLinkValid(Pin* output, Pin* input)
 
 Pin* NodeEditorManager::FindPin(ed::PinId id)
 {
-    // Search all nodes for this pin
-    for (auto& node : m_Nodes)
-    {
-        if (auto pin = node->FindPin(id))
-            return pin;
-    }
+    // The owning node is encoded in the pin ID
+    if (auto node = FindNode(ed::NodeId(PinIdLayout::NodeId(id))))
+        return node->FindPin(id);
 
     return nullptr;
 }
 
 bool NodeEditorManager::IsPinLinked(ed::PinId id)
 {
-    // Check if this pin is connected to any link
-    for (auto& link : m_Links)
-    {
-        if (link->StartPinID == id || link->EndPinID == id)
-            return true;
-    }
+    auto it = m_PinLinks.find((uint64_t)id.Get());
+    return it != m_PinLinks.end() && !it->second.empty();
+}
 
-    return false;
+const std::vector<Link*>& NodeEditorManager::GetLinksForPin(ed::PinId id)
+{
+    static const std::vector<Link*> noLinks;
+
+    auto it = m_PinLinks.find((uint64_t)id.Get());
+    return (it != m_PinLinks.end()) ? it->second : noLinks;
 }
 
-std::vector<Link*> NodeEditorManager::GetLinksForPin(ed::PinId id)
+void NodeEditorManager::IndexLink(Link* link)
 {
-    std::vector<Link*> result;
+    m_PinLinks[(uint64_t)link->StartPinID.Get()].push_back(link);
+    m_PinLinks[(uint64_t)link->EndPinID.Get()].push_back(link);
 
-    for (auto& link : m_Links)
+    Node* consumer = FindNode(ed::NodeId(PinIdLayout::NodeId(link->EndPinID)));
+    if (consumer)
+        m_NodeSuccessors[PinIdLayout::NodeId(link->StartPinID)].push_back(consumer);
+}
+
+void NodeEditorManager::UnindexLink(Link* link)
+{
+    // Remove one entry from a vector-backed multiset, erasing the key once it is empty
+    auto eraseOne = [](auto& map, uint64_t key, auto value)
     {
-        if (link->StartPinID == id || link->EndPinID == id)
-            result.push_back(link.get());
-    }
+        auto it = map.find(key);
+        if (it == map.end())
+            return;
+
+        auto& values = it->second;
+        auto pos = std::find(values.begin(), values.end(), value);
+        if (pos != values.end())
+        {
+            *pos = values.back();
+            values.pop_back();
+        }
+        if (values.empty())
+            map.erase(it);
+    };
+
+    eraseOne(m_PinLinks, (uint64_t)link->StartPinID.Get(), link);
+    eraseOne(m_PinLinks, (uint64_t)link->EndPinID.Get(), link);
 
-    return result;
+    Node* consumer = FindNode(ed::NodeId(PinIdLayout::NodeId(link->EndPinID)));
+    eraseOne(m_NodeSuccessors, PinIdLayout::NodeId(link->StartPinID), consumer);
 }
 
 Node* NodeEditorManager::GetSelectedNode()
@@ -372,13 +494,14 @@ void NodeEditorManager::ProcessSelection()
     auto nodeCount = ed::GetSelectedObjectCount();
     if (nodeCount > 0)
     {
-        std::vector<ed::NodeId> selectedNodes(nodeCount);
-        auto count = ed::GetSelectedNodes(selectedNodes.data(), nodeCount);
+        // Keeps its capacity, so a steady selection allocates nothing
+        m_SelectionScratch.resize(nodeCount);
+        auto count = ed::GetSelectedNodes(m_SelectionScratch.data(), nodeCount);
 
         if (count > 0)
         {
             // For simplicity, just use the first selected node
-            auto selectedNodeId = selectedNodes[0];
+            auto selectedNodeId = m_SelectionScratch[0];
 
             // Check if selection changed
             if (selectedNodeId != m_SelectedNodeId)
@@ -411,125 +534,1674 @@ void NodeEditorManager::ProcessSelection()
 
 bool NodeEditorManager::CalculateProcessingOrder()
 {
-    // Clear the processing queue
-    m_ProcessingQueue.clear();
+    // Clear the execution plan
+    m_ExecutionPlan.clear();
+    m_ExecutionPlan.reserve(m_Nodes.size());
 
-    // Find all nodes with no inputs (source nodes)
-    std::vector<Node*> sourceNodes;
+    // Count linked inputs per node using the pin -> links index
+    std::unordered_map<Node*, int> inDegree;
+    inDegree.reserve(m_Nodes.size());
     for (auto& node : m_Nodes)
     {
-        bool isSourceNode = true;
+        int linkedInputs = 0;
         for (auto& input : node->Inputs)
+            linkedInputs += (int)GetLinksForPin(input.ID).size();
+        inDegree[node.get()] = linkedInputs;
+    }
+
+    // Kahn's algorithm: start from source nodes (no linked inputs), in creation order
+    for (auto& node : m_Nodes)
+    {
+        if (inDegree[node.get()] == 0)
+            m_ExecutionPlan.push_back({ node.get(), 0, {} });
+    }
+
+    m_StepOfNode.clear();
+    m_StepOfNode.reserve(m_Nodes.size());
+    for (size_t head = 0; head < m_ExecutionPlan.size(); head++)
+    {
+        Node* current = m_ExecutionPlan[head].Node;
+        m_StepOfNode[(uint64_t)current->ID.Get()] = (int)head;
+
+        auto it = m_NodeSuccessors.find((uint64_t)current->ID.Get());
+        if (it == m_NodeSuccessors.end())
+            continue;
+
+        for (Node* next : it->second)
         {
-            if (IsPinLinked(input.ID))
-            {
-                isSourceNode = false;
-                break;
-            }
+            if (--inDegree[next] == 0)
+                m_ExecutionPlan.push_back({ next, 0, {} });
+        }
+    }
+
+    // Nodes left over are part of a cycle
+    if (m_ExecutionPlan.size() != m_Nodes.size())
+        return false;
+
+    // Resolve the dependency edges to plan indices for the scheduler
+    for (auto& step : m_ExecutionPlan)
+    {
+        auto it = m_NodeSuccessors.find((uint64_t)step.Node->ID.Get());
+        if (it == m_NodeSuccessors.end())
+            continue;
+
+        for (Node* next : it->second)
+        {
+            int nextIndex = m_StepOfNode[(uint64_t)next->ID.Get()];
+            step.Successors.push_back(nextIndex);
+            m_ExecutionPlan[nextIndex].PredecessorCount++;
+        }
+    }
+
+    return true;
+}
+
+void NodeEditorManager::InvalidatePlan()
+{
+    m_PlanDirty = true;
+}
+
+bool NodeEditorManager::InputsChanged(Node* node) const
+{
+    // Re-run if any input now carries data the node has not seen yet
+    // (an upstream node re-ran, or the input was linked/unlinked)
+    const ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    for (const auto& input : node->Inputs)
+    {
+        if (dataManager.GetInputVersion(input.ID) != input.ConsumedVersion)
+            return true;
+    }
+
+    return false;
+}
+
+void NodeEditorManager::ProcessNodes()
+{
+    // Pick up the results of an evaluation started on an earlier frame. While it is
+    // running the UI keeps drawing the results of the previous one.
+    if (m_Evaluation)
+    {
+        // A newer edit makes the running work stale. Cancel it, so the next evaluation
+        // only has to wait for the nodes to reach their next cancellation check.
+        if (!m_Evaluation->Context.IsCancelled() && IsEvaluationSuperseded())
+            m_Evaluation->Context.Cancel();
+
+        if (m_Evaluation->Pending.load() != 0)
+        {
+            // The selected node and the previews on screen need not wait for the rest
+            if (!m_Evaluation->FocusPublished && m_Evaluation->FocusPending.load() == 0)
+                PublishFocusedResults();
+            return;
+        }
+
+        FinishEvaluation();
+        EnforceMemoryBudget();
+        ImageDataManager::GetInstance().AgeImages();
+        RecoverLostOutputs();
+        // The workers stored their results, record them in the index once per evaluation
+        if (m_DiskCache)
+            m_DiskCache->Flush();
+        m_ColdImagesChanged = true;
+    }
+
+    // The execution plan survives across frames and is only recompiled after
+    // nodes or links were created or deleted
+    bool planRebuilt = false;
+    if (m_PlanDirty)
+    {
+        m_PlanValid = CalculateProcessingOrder(); // Fails on cycles
+        m_PlanDirty = false;
+        planRebuilt = true;
+        m_ColdImagesChanged = true; // Eviction candidates depend on the consumers
+
+        // Update connection map in the ImageDataManager. Safe because no evaluation
+        // is running, and it stays fixed until the next one has finished.
+        ImageDataManager::GetInstance().UpdateConnections(GetLinks());
+
+        // Streamed nodes published no data. Run them again in case the new plan
+        // gives them a consumer, or no longer streams them.
+        for (auto& node : m_Nodes)
+        {
+            if (node->OutputStreamed)
+                node->SetDirty(true);
         }
+    }
+
+    if (!m_PlanValid)
+        return;
+
+    // A node that becomes live catches up with the edits and input changes it missed
+    const bool becameLive = UpdateLiveness(planRebuilt);
+
+    // Whether a live node is dirty. None can be while the node change count is where
+    // the last idle frame left it, so an idle frame does not look at the nodes.
+    bool anyEdit = false;
+    if (Node::GetChangeCount() != m_IdleChangeCount)
+    {
+        for (size_t i = 0; i < m_ExecutionPlan.size(); i++)
+            anyEdit = anyEdit || (m_LiveSteps[i] && m_ExecutionPlan[i].Node->IsDirty());
+    }
+
+    // Proxy resolution: while a slider is dragged, edits run on downscaled inputs. Once
+    // it is released the graph is refined at full resolution. Changing the scale
+    // changes every image, so the whole graph runs again at the new one.
+    double proxyScale = 1.0;
+    if (m_ProxyResolution && ImGui::IsAnyItemActive())
+    {
+        // Holding a widget without changing anything keeps the current results
+        proxyScale = anyEdit ? ChooseProxyScale() : m_ProxyScale;
+    }
+    if (proxyScale != m_ProxyScale)
+    {
+        m_ProxyScale = proxyScale;
+        for (auto& node : m_Nodes)
+            node->SetDirty(true);
+        anyEdit = true;
+    }
+
+    // Input versions can only have changed if the links changed or a node runs
+    bool anyWork = planRebuilt || m_ResumeCancelledWork || becameLive || anyEdit;
+    if (!anyWork)
+    {
+        m_IdleChangeCount = Node::GetChangeCount();
+        CompressColdImages();
+        return;
+    }
+
+    // The cache keys need the content hashes of new source images. The UI keeps
+    // drawing the previous results while a worker computes them.
+    if (!PrepareContentHashes())
+        return;
+
+    m_ResumeCancelledWork = false;
+    StartEvaluation();
+}
+
+bool NodeEditorManager::PrepareContentHashes()
+{
+    bool ready = m_ContentHashesInFlight.load() == 0;
+    for (size_t i = 0; i < m_ExecutionPlan.size(); i++)
+    {
+        if (!m_LiveSteps[i])
+            continue;
+
+        std::function<void()> work = m_ExecutionPlan[i].Node->StartContentHash();
+        if (!work)
+            continue;
 
-        if (isSourceNode)
-            sourceNodes.push_back(node.get());
+        m_ContentHashesInFlight++;
+        m_ThreadPool->Submit([this, work]
+        {
+            work();
+            m_ContentHashesInFlight--;
+        });
+        ready = false;
     }
+    return ready;
+}
 
-    // No source nodes, can't process
-    if (sourceNodes.empty())
+bool NodeEditorManager::UpdateLiveness(bool planRebuilt)
+{
+    // Liveness only changes with the plan or with its roots. The buffers keep their
+    // capacity, so this allocates nothing unless the graph grew.
+    const int stepCount = (int)m_ExecutionPlan.size();
+    bool rootsChanged = planRebuilt || (int)m_LiveRoots.size() != stepCount;
+    // The roots only change with the OnScreen flags and the preview toggles, which
+    // advance the node change count
+    const uint64_t changeCount = Node::GetChangeCount();
+    if (!rootsChanged && changeCount == m_LiveRootsChangeCount)
+        return false;
+    m_LiveRootsChangeCount = changeCount;
+    m_LiveRoots.resize(stepCount, 0);
+    for (int i = 0; i < stepCount; i++)
+    {
+        Node* node = m_ExecutionPlan[i].Node;
+        const char isRoot = node->IsGraphOutput() || (node->IsPreviewShown() && node->IsOnScreen());
+        rootsChanged = rootsChanged || isRoot != m_LiveRoots[i];
+        m_LiveRoots[i] = isRoot;
+    }
+    if (!rootsChanged)
         return false;
 
-    // Use topological sort to order nodes
-    std::set<Node*> visited;
-    std::set<Node*> inStack; // For cycle detection
-    std::function<bool(Node*)> visit;
+    // Walk the plan backwards, so every consumer is decided before its producers
+    std::vector<char>& live = m_LiveScratch;
+    live.assign(stepCount, 0);
+    bool becameLive = false;
+    for (int i = stepCount - 1; i >= 0; i--)
+    {
+        const PlanStep& step = m_ExecutionPlan[i];
+        bool isLive = m_LiveRoots[i] != 0;
+        for (int next : step.Successors)
+            isLive = isLive || live[next];
+
+        live[i] = isLive;
+        becameLive = becameLive || (isLive && (i >= (int)m_LiveSteps.size() || !m_LiveSteps[i]));
+    }
 
-    visit = [&](Node* node) -> bool {
-        if (inStack.find(node) != inStack.end())
-            return false; // Cycle detected
+    m_LiveSteps.swap(live);
+    return becameLive;
+}
 
-        if (visited.find(node) != visited.end())
-            return true; // Already processed
+void NodeEditorManager::MergeIdenticalNodes(Evaluation* evaluation)
+{
+    // Live nodes of the same type, with the same parameters and fed from the same pins
+    // compute the same images. The first one in plan order is evaluated, the others
+    // wait for it and share its results. Sources are compared after merging, so whole
+    // copied subgraphs collapse, not just their first nodes.
+    const int stepCount = (int)m_ExecutionPlan.size();
 
-        inStack.insert(node);
+    struct Signature
+    {
+        int Step;
+        size_t ParameterHash;
+        std::vector<uint64_t> Sources;
+    };
+    std::unordered_map<size_t, std::vector<Signature>> signatures;
 
-        // Find all nodes connected to outputs of this node
-        for (auto& output : node->Outputs)
+    for (int i = 0; i < stepCount; i++)
+    {
+        Node* node = m_ExecutionPlan[i].Node;
+        size_t parameterHash = 0;
+        if (!evaluation->Live[i] || !node->GetParameterHash(parameterHash))
+            continue;
+
+        // Every input by the output pin feeding it, as merged so far (0 if unlinked)
+        Signature signature{ i, parameterHash, {} };
+        size_t hash = parameterHash;
+        Node::HashCombine(hash, std::type_index(typeid(*node)));
+        for (auto& input : node->Inputs)
         {
-            for (auto& link : m_Links)
+            uint64_t source = 0;
+            const std::vector<Link*>& links = GetLinksForPin(input.ID);
+            if (!links.empty())
             {
-                if (link->StartPinID == output.ID)
+                source = (uint64_t)links[0]->StartPinID.Get();
+                int producer = m_StepOfNode[PinIdLayout::NodeId(links[0]->StartPinID)];
+                int canonical = evaluation->Canonical[producer];
+                if (canonical >= 0)
                 {
-                    auto inputPin = FindPin(link->EndPinID);
-                    if (inputPin && inputPin->Node)
+                    const auto& outputs = m_ExecutionPlan[producer].Node->Outputs;
+                    for (size_t k = 0; k < outputs.size(); k++)
                     {
-                        if (!visit(inputPin->Node))
-                            return false;
+                        if (outputs[k].ID == links[0]->StartPinID)
+                            source = (uint64_t)m_ExecutionPlan[canonical].Node->Outputs[k].ID.Get();
                     }
                 }
             }
+            signature.Sources.push_back(source);
+            Node::HashCombine(hash, source);
         }
 
-        visited.insert(node);
-        inStack.erase(node);
+        std::vector<Signature>& candidates = signatures[hash];
+        for (const Signature& other : candidates)
+        {
+            if (typeid(*m_ExecutionPlan[other.Step].Node) == typeid(*node) &&
+                other.ParameterHash == parameterHash && other.Sources == signature.Sources)
+            {
+                evaluation->Canonical[i] = other.Step;
+                break;
+            }
+        }
 
-        // Add to processing queue in reverse order (we'll reverse it at the end)
-        m_ProcessingQueue.push_front(node);
+        if (evaluation->Canonical[i] < 0)
+        {
+            candidates.push_back(std::move(signature));
+            continue;
+        }
 
-        return true;
-        };
+        // Runs once the node it shares with finished
+        const int canonical = evaluation->Canonical[i];
+        evaluation->Duplicates[canonical].push_back(i);
+        evaluation->Remaining[i]++;
+        evaluation->MergedNodes++;
+    }
 
-    // Start with source nodes
-    for (auto node : sourceNodes)
+    // The editor marks merged nodes. A node merged with a different one than last
+    // time has to take over its results even if nothing else changed.
+    for (int i = 0; i < stepCount; i++)
     {
-        if (!visit(node))
-            return false; // Cycle detected
+        Node* node = m_ExecutionPlan[i].Node;
+        const int canonical = evaluation->Canonical[i];
+        ed::NodeId mergedInto = canonical >= 0 ? m_ExecutionPlan[canonical].Node->ID : ed::NodeId(0);
+        if (canonical >= 0 && node->MergedInto != mergedInto)
+            evaluation->Dirty[i] = 1;
+        node->MergedInto = mergedInto;
     }
+}
 
-    // Make sure all nodes are included
-    if (visited.size() != m_Nodes.size())
+void NodeEditorManager::ComputeCacheKeys(Evaluation* evaluation)
+{
+    // A node's results are keyed by how they are computed: its type, its parameters,
+    // the outputs asked of it and the keys of the outputs feeding it. Source nodes key
+    // the content of their data, so the keys of identical images match. A node whose
+    // results depend on anything else (random noise) has no key, nor has anything
+    // downstream of it.
+    const int stepCount = (int)m_ExecutionPlan.size();
+    const double scale = evaluation->Context.GetProxyScale();
+    const bool halfPrecision = ImageDataManager::GetInstance().GetHalfPrecisionStorage();
+    for (int i = 0; i < stepCount; i++)
     {
-        // There are nodes that aren't connected to any source
-        // We can either fail or include them at the end
-        for (auto& node : m_Nodes)
+        Node* node = m_ExecutionPlan[i].Node;
+        size_t resultHash = 0;
+        if (!evaluation->Live[i] || !node->GetResultHash(resultHash))
+            continue;
+
+        // Stored on disk as well, so nothing in the key may change between sessions:
+        // the type goes in by name, the producers by their keys rather than their IDs
+        size_t key = resultHash;
+        Node::HashCombine(key, std::string(typeid(*node).name()));
+        Node::HashCombine(key, node->RequestedOutputs);
+        Node::HashCombine(key, scale);
+        if (halfPrecision)
+            Node::HashCombine(key, CV_16F); // Rounded results, single precision keys stay as they were
+        bool keyed = true;
+        for (auto& input : node->Inputs)
         {
-            if (visited.find(node.get()) == visited.end())
+            const std::vector<Link*>& links = GetLinksForPin(input.ID);
+            if (links.empty())
             {
-                m_ProcessingQueue.push_back(node.get());
+                Node::HashCombine(key, 0);
+                continue;
             }
+
+            const int producer = m_StepOfNode[PinIdLayout::NodeId(links[0]->StartPinID)];
+            keyed = keyed && evaluation->CacheKey[producer] != 0;
+            Node::HashCombine(key, evaluation->CacheKey[producer]);
+            Node::HashCombine(key, PinIdLayout::Index(links[0]->StartPinID));
+        }
+        if (!keyed)
+            continue;
+
+        evaluation->CacheKey[i] = key != 0 ? key : 1;
+
+        // Going back to results computed before: load them instead of running the node
+        if (!node->Inputs.empty() && evaluation->Canonical[i] < 0 && evaluation->CacheKey[i] != node->ResultKey &&
+            (m_ResultCache.Contains(evaluation->CacheKey[i]) || (m_DiskCache && m_DiskCache->Contains(evaluation->CacheKey[i]))))
+        {
+            evaluation->CacheHit[i] = 1;
         }
     }
+}
 
-    return true;
+void NodeEditorManager::RecomputeEvictedInputs(Evaluation* evaluation)
+{
+    // A node that runs needs the outputs it reads. Evicted ones are recomputed first,
+    // which makes their other consumers run as well, so repeat until nothing changes.
+    const int stepCount = (int)m_ExecutionPlan.size();
+    bool anyEvicted = false;
+    for (int i = 0; i < stepCount; i++)
+        anyEvicted = anyEvicted || (evaluation->Live[i] && m_ExecutionPlan[i].Node->OutputEvicted);
+    if (!anyEvicted)
+        return;
+
+    std::vector<char> runs(stepCount, 0);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < stepCount; i++)
+        {
+            if (!evaluation->Live[i])
+                continue;
+            runs[i] = runs[i] || evaluation->Dirty[i] || InputsChanged(m_ExecutionPlan[i].Node);
+            if (!runs[i])
+                continue;
+            for (int next : m_ExecutionPlan[i].Successors)
+                runs[next] = 1;
+            for (int duplicate : evaluation->Duplicates[i])
+                runs[duplicate] = 1;
+        }
+
+        // Producers come first in the plan, walking backwards reaches the whole cone
+        for (int i = stepCount - 1; i >= 0; i--)
+        {
+            if (!runs[i])
+                continue;
+
+            std::vector<int> producers;
+            for (auto& input : m_ExecutionPlan[i].Node->Inputs)
+            {
+                const std::vector<Link*>& links = GetLinksForPin(input.ID);
+                if (!links.empty())
+                    producers.push_back(m_StepOfNode[PinIdLayout::NodeId(links[0]->StartPinID)]);
+            }
+            if (evaluation->Canonical[i] >= 0)
+                producers.push_back(evaluation->Canonical[i]);
+
+            for (int producer : producers)
+            {
+                if (!m_ExecutionPlan[producer].Node->OutputEvicted || evaluation->Dirty[producer])
+                    continue;
+                evaluation->Dirty[producer] = 1;
+                runs[producer] = 1;
+                evaluation->RecomputedNodes++;
+                changed = true;
+            }
+        }
+    }
 }
 
-void NodeEditorManager::ProcessNodes()
+bool NodeEditorManager::IsEvictable(Node* node)
 {
-    // Calculate processing order
-    if (!CalculateProcessingOrder())
-        return; // Failed to calculate order (likely due to cycles)
+    // Sources hold their data anyway, and the images feeding a graph output are the
+    // results themselves: evicting either would free nothing
+    if (node->Inputs.empty() || node->IsGraphOutput() || node->OutputEvicted)
+        return false;
+
+    auto successors = m_NodeSuccessors.find((uint64_t)node->ID.Get());
+    if (successors == m_NodeSuccessors.end())
+        return true;
+    for (Node* consumer : successors->second)
+    {
+        if (consumer->IsGraphOutput())
+            return false;
+    }
+    return true;
+}
 
-    // Update connection map in the ImageDataManager
-    ImageDataManager::GetInstance().UpdateConnections(GetLinks());
+void NodeEditorManager::EnforceMemoryBudget()
+{
+    // Runs between evaluations, so no worker reads the images or the nodes meanwhile
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    m_MemoryUsage = MeasureMemoryUsage();
+    if (m_MemoryBudget == 0 || m_MemoryUsage <= m_MemoryBudget || m_Evaluation)
+        return;
 
-    // Process nodes in order
-    for (auto node : m_ProcessingQueue)
+    // Whole nodes are evicted, by their least recently published or read output
+    const uint64_t evictions = m_EvaluationStats.Evictions;
+    for (uint64_t pinId : dataManager.GetOutputPinsByLastUse())
     {
-        if (node->Dirty)
+        if (m_MemoryUsage <= m_MemoryBudget)
+            break;
+
+        Node* node = FindNode(PinIdLayout::NodeId(ed::PinId(pinId)));
+        if (!node || !IsEvictable(node))
+            continue;
+
+        for (auto& output : node->Outputs)
+            dataManager.ClearImageData(output.ID);
+        node->ReleaseResults();
+        node->OutputEvicted = true;
+        node->ResultKey = 0; // Holds no results now, the result cache may provide them again
+        // Consumers drop their inputs once they ran, unless an evaluation left them
+        // holding one. Either way nothing may keep the evicted buffers alive.
+        auto successors = m_NodeSuccessors.find((uint64_t)node->ID.Get());
+        if (successors != m_NodeSuccessors.end())
         {
-            node->Process();
-            node->Dirty = false;
+            for (Node* consumer : successors->second)
+                consumer->ReleaseInputs();
         }
+        m_EvaluationStats.Evictions++;
+        m_MemoryUsage = MeasureMemoryUsage();
     }
+
+    // Freed buffers would only move to the buffer pool, give them back to the system
+    if (m_EvaluationStats.Evictions != evictions)
+        BufferPool::GetInstance().Trim();
 }
 
-void NodeEditorManager::SyncAllNodes()
+void NodeEditorManager::RecoverLostOutputs()
+{
+    // The consumers read these outputs as empty. Running them again recomputes the
+    // producers first, like any evicted node (see RecomputeEvictedInputs).
+    for (uint64_t pinId : ImageDataManager::GetInstance().TakeLostOutputPins())
+    {
+        Node* node = FindNode(PinIdLayout::NodeId(ed::PinId(pinId)));
+        if (!node)
+            continue;
+        node->ReleaseResults();
+        node->OutputEvicted = true;
+        node->ResultKey = 0;
+        auto successors = m_NodeSuccessors.find((uint64_t)node->ID.Get());
+        if (successors == m_NodeSuccessors.end())
+            continue;
+        for (Node* consumer : successors->second)
+            consumer->SetDirty(true);
+    }
+}
+
+size_t NodeEditorManager::MeasureMemoryUsage()
 {
-    // Mark all nodes as dirty
     for (auto& node : m_Nodes)
+        node->GetHeldImages(m_HeldImages);
+    const size_t bytes = ImageDataManager::GetInstance().GetMemoryUsage(m_HeldImages);
+    m_HeldImages.clear();
+    return bytes;
+}
+
+void NodeEditorManager::CompressColdImages()
+{
+    // One round at a time. A compression that finishes while an evaluation runs is
+    // safe, ImageDataManager drops it if the image was read or replaced meanwhile.
+    // Images only turn cold when an evaluation finished, and candidates only change
+    // with the graph, so idle frames skip the search.
+    if (!m_ColdImagesChanged || m_CompressAfter <= 0 || m_CompressionsInFlight.load() != 0)
+        return;
+    m_ColdImagesChanged = false;
+
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    for (uint64_t pinId : dataManager.GetColdOutputPins(m_CompressAfter))
+    {
+        // Same candidates as for eviction. The node drops its own references first, its
+        // preview stays and consumers still find the full image, decompressed on access.
+        Node* node = FindNode(PinIdLayout::NodeId(ed::PinId(pinId)));
+        if (!node || !IsEvictable(node))
+            continue;
+        node->ReleaseResults();
+
+        m_CompressionsInFlight++;
+        m_ThreadPool->Submit([this, pinId]
+        {
+            ImageDataManager::GetInstance().CompressImage(pinId);
+            m_CompressionsInFlight--;
+        });
+    }
+}
+
+void NodeEditorManager::SetMemoryBudget(size_t bytes)
+{
+    m_MemoryBudget = bytes;
+    EnforceMemoryBudget();
+}
+
+void NodeEditorManager::SetThreadCount(unsigned count)
+{
+    // Leave one core for the UI thread by default
+    if (count == 0)
+        count = std::max(1u, ThreadPool::GetHardwareThreadCount() - 1);
+    if (m_ThreadPool && count == m_ThreadPool->GetThreadCount())
+        return;
+
+    // Nothing may be queued on the old pool once it goes, OpenCV included
+    if (m_ThreadPool)
+    {
+        WaitForEvaluation();
+        m_ThreadPool->RunUntil([this] { return m_CompressionsInFlight.load() == 0 && m_ContentHashesInFlight.load() == 0; });
+        ThreadPoolParallelBackend::Install(nullptr);
+    }
+    m_ThreadPool = std::make_unique<ThreadPool>(count);
+    ThreadPoolParallelBackend::Install(m_ThreadPool.get());
+}
+
+void NodeEditorManager::SetHalfPrecisionStorage(bool enabled)
+{
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    if (enabled == dataManager.GetHalfPrecisionStorage())
+        return;
+
+    // Running evaluations publish in the mode they started with, then everything is
+    // stored again in the new one. Results of either mode stay cached under their keys.
+    WaitForEvaluation();
+    dataManager.SetHalfPrecisionStorage(enabled);
+    SyncAllNodes();
+}
+
+bool NodeEditorManager::IsHalfPrecisionStorage() const
+{
+    return ImageDataManager::GetInstance().GetHalfPrecisionStorage();
+}
+
+void NodeEditorManager::SetDiskCache(const std::string& directory, size_t capacityBytes)
+{
+    // Workers write to the disk cache, wait for them before replacing it
+    WaitForEvaluation();
+    m_DiskCache.reset();
+    if (!directory.empty())
+        m_DiskCache = std::make_unique<DiskResultCache>(directory, capacityBytes);
+}
+
+void NodeEditorManager::StoreResults(Evaluation* evaluation, int index)
+{
+    // Called once a node ran. Nodes that kept no full output have nothing to store.
+    Node* node = m_ExecutionPlan[index].Node;
+    const size_t key = evaluation->CacheKey[index];
+    node->ResultKey = node->OutputStreamed ? 0 : key;
+    // Source nodes only key their data for their consumers, storing it would copy the source
+    if (node->ResultKey == 0 || node->Inputs.empty())
+        return;
+
+    auto results = std::make_shared<NodeResults>();
+    node->SaveResults(*results);
+    // Proxies are redone at full resolution as soon as the drag ends, not worth the disk
+    if (m_DiskCache && evaluation->Context.GetProxyScale() == 1.0)
+        m_DiskCache->Store(key, *results);
+    m_ResultCache.Insert(key, std::move(results));
+    node->CacheMisses++;
+    evaluation->CacheMisses++;
+}
+
+void NodeEditorManager::RequestOutputs(Evaluation* evaluation)
+{
+    // An output is needed if a live node reads it, or the node shows its previews
+    const int stepCount = (int)m_ExecutionPlan.size();
+    std::vector<uint32_t> requested(stepCount, 0);
+    for (int i = 0; i < stepCount; i++)
     {
-        node->Dirty = true;
+        Node* node = m_ExecutionPlan[i].Node;
+        if (!evaluation->Live[i])
+            continue;
+
+        if (node->IsPreviewShown() && node->IsOnScreen())
+        {
+            requested[i] = node->Outputs.size() >= 32 ? ~0u : (1u << node->Outputs.size()) - 1;
+            continue;
+        }
+
+        for (size_t k = 0; k < node->Outputs.size(); k++)
+        {
+            for (Link* link : GetLinksForPin(node->Outputs[k].ID))
+            {
+                auto consumer = m_StepOfNode.find(PinIdLayout::NodeId(link->EndPinID));
+                if (consumer != m_StepOfNode.end() && evaluation->Live[consumer->second])
+                    requested[i] |= 1u << k;
+            }
+        }
     }
 
-    // Process all nodes
-    ProcessNodes();
+    // A duplicate's consumers read what the node it shares with computes
+    for (int i = 0; i < stepCount; i++)
+    {
+        if (evaluation->Canonical[i] >= 0)
+            requested[evaluation->Canonical[i]] |= requested[i];
+    }
+
+    for (int i = 0; i < stepCount; i++)
+    {
+        Node* node = m_ExecutionPlan[i].Node;
+        if (!evaluation->Live[i])
+            continue;
+
+        // Asking for an output the last run left out means running again
+        if (requested[i] & ~node->ComputedOutputs)
+            evaluation->Dirty[i] = 1;
+        node->RequestedOutputs = requested[i];
+
+        if (node->Outputs.size() > 1)
+        {
+            for (size_t k = 0; k < node->Outputs.size(); k++)
+                evaluation->SkippedOutputs += node->IsOutputRequested(k) ? 0 : 1;
+        }
+    }
+}
+
+double NodeEditorManager::ChooseProxyScale() const
+{
+    // Cost is proportional to the pixel count. Halve the resolution until the last
+    // edit's cost, extrapolated from full resolution, fits the budget.
+    double scale = 1.0;
+    while (scale > MinProxyScale && m_FullResolutionCostMs * scale * scale > m_ProxyBudgetMs)
+        scale *= 0.5;
+    return scale;
+}
+
+bool NodeEditorManager::IsEvaluationSuperseded() const
+{
+    // Links or nodes changed, the running plan no longer matches the graph
+    if (m_PlanDirty)
+        return true;
+    // No node was marked dirty since the evaluation started
+    if (Node::GetChangeCount() == m_Evaluation->ChangeCount)
+        return false;
+
+    // A node edited since the evaluation started makes everything downstream of it
+    // stale. Worth cancelling if any of that is still waiting or running.
+    const int stepCount = (int)m_ExecutionPlan.size();
+    std::vector<char> stale(stepCount, 0);
+    for (int i = 0; i < stepCount; i++)
+    {
+        const PlanStep& step = m_ExecutionPlan[i];
+        if (step.Node->IsDirty())
+            stale[i] = 1;
+        if (!stale[i])
+            continue;
+
+        if (step.Node->Computing)
+            return true;
+        for (int next : step.Successors)
+            stale[next] = 1;
+    }
+
+    return false;
+}
+
+void NodeEditorManager::StartEvaluation()
+{
+    const int stepCount = (int)m_ExecutionPlan.size();
+    m_Evaluation = std::make_unique<Evaluation>(stepCount);
+    Evaluation* evaluation = m_Evaluation.get();
+    evaluation->StartTime = std::chrono::steady_clock::now();
+    evaluation->Tiled = m_TiledEvaluation;
+    evaluation->Context.SetProxyScale(m_ProxyScale);
+    evaluation->Streaming = m_StreamingEvaluation;
+    evaluation->Fusion = m_PointwiseFusion;
+    evaluation->Pending = stepCount;
+
+    // Snapshot the graph: the evaluation works on the parameters and Dirty flags as
+    // they are now, the UI is free to keep editing them (and deleting nodes) meanwhile
+    std::unordered_map<Node*, std::shared_ptr<Node>> owners;
+    owners.reserve(m_Nodes.size());
+    for (auto& node : m_Nodes)
+        owners[node.get()] = node;
+
+    for (int i = 0; i < stepCount; i++)
+    {
+        Node* node = m_ExecutionPlan[i].Node;
+        evaluation->Nodes[i] = owners[node];
+        evaluation->Remaining[i].store(m_ExecutionPlan[i].PredecessorCount);
+        evaluation->Live[i] = m_LiveSteps[i];
+
+        // Dead nodes keep their Dirty flag for the evaluation that needs them
+        if (node->IsDirty() && evaluation->Live[i])
+        {
+            node->CaptureParameters();
+            if (m_ProxyScale < 1.0)
+                node->ScaleParameters(m_ProxyScale);
+            node->SetDirty(false);
+            evaluation->Dirty[i] = 1;
+        }
+    }
+    evaluation->ChangeCount = Node::GetChangeCount();
+
+    MergeIdenticalNodes(evaluation);
+    RequestOutputs(evaluation);
+    ComputeCacheKeys(evaluation);
+
+    // A node that only needs a region of its input (OutputNode inspecting at 1:1) is
+    // appended to the chain feeding it, so the chain computes just that region
+    bool anyRegionRequest = false;
+    for (int i = 0; i < stepCount; i++)
+    {
+        Node* node = m_ExecutionPlan[i].Node;
+        if (node->Inputs.size() == 1 && m_ExecutionPlan[i].PredecessorCount == 1 && node->RequestsRegion())
+        {
+            evaluation->RegionRequest[i] = 1;
+            anyRegionRequest = true;
+        }
+    }
+
+    // Linear runs of tileable nodes are evaluated as one unit, tile by tile or row by
+    // row. A link only joins a chain if it is the sole consumer of its producer and the
+    // first input of its consumer, so the whole chain can be scheduled like a single step.
+    if (m_TiledEvaluation || m_StreamingEvaluation || m_PointwiseFusion || anyRegionRequest)
+    {
+        for (int i = 0; i < stepCount; i++)
+        {
+            const PlanStep& step = m_ExecutionPlan[i];
+            if (step.Successors.size() != 1)
+                continue;
+
+            int next = step.Successors[0];
+            // Merged nodes are no chain members: a duplicate copies its results, and
+            // the node it copies from has to publish them whole
+            if (!evaluation->Live[next] || evaluation->Canonical[i] >= 0 || evaluation->Canonical[next] >= 0 ||
+                !evaluation->Duplicates[i].empty())
+                continue;
+            // Nor are nodes whose results are in the cache, they are loaded rather than computed
+            if (evaluation->CacheHit[i] || evaluation->CacheHit[next])
+                continue;
+            if (evaluation->RegionRequest[next] ? IsTileable(step.Node) : CanJoinChain(i, next))
+                evaluation->ChainNext[i] = next;
+        }
+    }
+
+    // A chain starts once every member's other inputs (the blend image of a fused
+    // BlendNode) are ready: their producers release the head of the chain instead
+    for (int i = 0; i < stepCount; i++)
+        evaluation->ChainHead[i] = i;
+    for (int i = 0; i < stepCount; i++)
+    {
+        for (int member = evaluation->ChainNext[i]; member >= 0 && evaluation->ChainHead[member] == member; member = evaluation->ChainNext[member])
+        {
+            evaluation->ChainHead[member] = evaluation->ChainHead[i];
+            evaluation->Remaining[evaluation->ChainHead[i]] += m_ExecutionPlan[member].PredecessorCount - 1;
+        }
+    }
+
+    // Nodes that kept no output last time (streamed, or only computed for a region) run
+    // again if anything is going to read their output the normal way
+    for (int i = 0; i < stepCount; i++)
+    {
+        if (!m_ExecutionPlan[i].Node->OutputStreamed || !evaluation->Live[i])
+            continue;
+
+        if (!evaluation->Duplicates[i].empty())
+            evaluation->Dirty[i] = 1;
+
+        for (int next : m_ExecutionPlan[i].Successors)
+        {
+            if (evaluation->ChainNext[i] != next)
+                evaluation->Dirty[i] = 1;
+        }
+    }
+
+    RecomputeEvictedInputs(evaluation);
+
+    // Everything downstream of an edit shows as computing until its step finished
+    for (int i = 0; i < stepCount; i++)
+    {
+        if (evaluation->Dirty[i])
+            m_ExecutionPlan[i].Node->Computing = true;
+        if (m_ExecutionPlan[i].Node->Computing)
+        {
+            for (int next : m_ExecutionPlan[i].Successors)
+            {
+                if (evaluation->Live[next])
+                    m_ExecutionPlan[next].Node->Computing = true;
+            }
+        }
+    }
+
+    ComputePriorities(evaluation);
+
+    // Dataflow execution: a node is launched as soon as all of its predecessors
+    // finished, on whichever worker is free
+    std::vector<int> ready;
+    for (int i = 0; i < stepCount; i++)
+    {
+        if (evaluation->ChainHead[i] == i && evaluation->Remaining[i].load() == 0)
+            ready.push_back(i);
+    }
+    ScheduleSteps(evaluation, ready.data(), (int)ready.size());
+}
+
+void NodeEditorManager::ComputePriorities(Evaluation* evaluation)
+{
+    // A step takes the highest priority of its consumers, so the whole upstream cone of
+    // the selected node and of the previews on screen runs first. Walking the plan
+    // backwards decides every consumer before its producers, like UpdateLiveness().
+    // The head of a chain feeds its members, so it is never below them.
+    const int stepCount = (int)m_ExecutionPlan.size();
+    int focused = 0;
+    for (int i = stepCount - 1; i >= 0; i--)
+    {
+        const PlanStep& step = m_ExecutionPlan[i];
+        int priority = PriorityBackground;
+        if (m_SelectedNodeId && step.Node->ID == m_SelectedNodeId)
+            priority = PrioritySelected;
+        else if (step.Node->IsPreviewShown() && step.Node->IsOnScreen())
+            priority = PriorityVisible;
+        for (int next : step.Successors)
+            priority = std::max(priority, evaluation->Priority[next]);
+
+        evaluation->Priority[i] = priority;
+        if (priority != PriorityBackground)
+            focused++;
+    }
+
+    evaluation->FocusPending = focused;
+    evaluation->FocusPublished = focused == 0;
+}
+
+void NodeEditorManager::ScheduleSteps(Evaluation* evaluation, const int* steps, int count)
+{
+    // Every task runs the most important step ready when it starts, not necessarily the
+    // one it was submitted for. Among equal priorities the step readied last runs first,
+    // like the pool's own LIFO order, so a consumer tends to find its input in cache.
+    if (count == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(evaluation->ReadyMutex);
+        for (int i = 0; i < count; i++)
+            evaluation->ReadySteps.emplace(evaluation->Priority[steps[i]], evaluation->ReadyCount++, steps[i]);
+    }
+    for (int i = 0; i < count; i++)
+        m_ThreadPool->Submit([this, evaluation] { RunReadyStep(evaluation); });
+}
+
+void NodeEditorManager::RunReadyStep(Evaluation* evaluation)
+{
+    // There are as many tasks as steps queued, so the queue is never empty here
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(evaluation->ReadyMutex);
+        index = std::get<2>(evaluation->ReadySteps.top());
+        evaluation->ReadySteps.pop();
+    }
+    RunStep(evaluation, index);
+}
+
+void NodeEditorManager::RunStep(Evaluation* evaluation, int index)
+{
+    // A step that starts a tiled chain runs the whole chain. The other members are
+    // never submitted on their own: only the last one releases its successors.
+    std::vector<int> chain{ index };
+    while (evaluation->ChainNext[chain.back()] >= 0)
+        chain.push_back(evaluation->ChainNext[chain.back()]);
+
+    // The plan is not rebuilt while an evaluation is running, so the steps stay valid
+    if (chain.size() > 1)
+    {
+        EvaluateChain(evaluation, chain);
+    }
+    else if (EvaluateStep(evaluation, index))
+    {
+        evaluation->Ran[index] = 1;
+        evaluation->Processed++;
+    }
+
+    for (int member : chain)
+        m_ExecutionPlan[member].Node->Computing = false;
+
+    std::vector<int> ready;
+    for (int next : m_ExecutionPlan[chain.back()].Successors)
+    {
+        int head = evaluation->ChainHead[next];
+        if (evaluation->Remaining[head].fetch_sub(1) == 1)
+            ready.push_back(head);
+    }
+    for (int duplicate : evaluation->Duplicates[chain.back()])
+    {
+        if (evaluation->Remaining[duplicate].fetch_sub(1) == 1)
+            ready.push_back(duplicate);
+    }
+    ScheduleSteps(evaluation, ready.data(), (int)ready.size());
+
+    // The UI thread shows the prioritized results once the last of them is done
+    int focused = 0;
+    for (int member : chain)
+    {
+        if (evaluation->Priority[member] != PriorityBackground)
+            focused++;
+    }
+    if (focused > 0)
+        evaluation->FocusPending.fetch_sub(focused);
+
+    // Must be the last access to the evaluation - the UI thread may free it right after
+    evaluation->Pending.fetch_sub((int)chain.size());
+}
+
+bool NodeEditorManager::EvaluateStep(Evaluation* evaluation, int index)
+{
+    Node* node = m_ExecutionPlan[index].Node;
+    const EvaluationContext& context = evaluation->Context;
+    if (context.IsCancelled() || !evaluation->Live[index])
+        return false;
+
+    // A duplicate follows the node it shares results with
+    const int canonical = evaluation->Canonical[index];
+    const bool canonicalRan = canonical >= 0 && evaluation->Ran[canonical];
+    if (!evaluation->Dirty[index] && !canonicalRan && !InputsChanged(node))
+        return false;
+
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+
+    // Drop the previous results so a node that produces nothing this time
+    // does not leave stale data behind for its consumers
+    for (auto& output : node->Outputs)
+        dataManager.ClearImageData(output.ID);
+
+    // Upstream nodes bump the versions of their outputs before their consumers
+    // start, so an edit recomputes exactly its downstream cone. Every node only
+    // reads its own inputs, so the results do not depend on the thread count or
+    // on the order nodes complete in.
+    std::shared_ptr<const NodeResults> cached;
+    if (canonical < 0 && evaluation->CacheKey[index] != 0)
+    {
+        cached = m_ResultCache.Find(evaluation->CacheKey[index]);
+        if (!cached && m_DiskCache)
+        {
+            // Results of an earlier session are kept in memory from now on
+            std::shared_ptr<NodeResults> loaded = m_DiskCache->Load(evaluation->CacheKey[index]);
+            if (loaded)
+            {
+                m_ResultCache.Insert(evaluation->CacheKey[index], loaded);
+                cached = std::move(loaded);
+                evaluation->DiskCacheHits++;
+            }
+        }
+    }
+
+    if (canonical >= 0)
+    {
+        node->ShareResults(*m_ExecutionPlan[canonical].Node);
+        node->ResultKey = evaluation->CacheKey[index];
+        node->OutputStreamed = false;
+    }
+    else if (cached)
+    {
+        node->LoadResults(*cached);
+        node->ResultKey = evaluation->CacheKey[index];
+        node->OutputStreamed = false;
+        node->CacheHits++;
+        evaluation->CacheHits++;
+    }
+    else
+    {
+        node->Process(context);
+
+        // A cancelled node may have stopped half way. Its versions stay as they are,
+        // so the next evaluation runs it (and everything downstream) again.
+        if (context.IsCancelled())
+            return false;
+
+        node->PreparePreview();
+        node->OutputStreamed = false;
+        StoreResults(evaluation, index);
+    }
+    node->ComputedOutputs = node->RequestedOutputs;
+    node->OutputEvicted = false;
+
+    for (auto& input : node->Inputs)
+        input.ConsumedVersion = dataManager.GetInputVersion(input.ID);
+    for (auto& output : node->Outputs)
+        dataManager.BumpVersion(output.ID);
+
+    return true;
+}
+
+void NodeEditorManager::SetStreamingEvaluation(bool enabled)
+{
+    if (enabled == m_StreamingEvaluation)
+        return;
+
+    // Rebuilding the plan re-runs the nodes that were streamed, so that they publish
+    // their outputs again
+    m_StreamingEvaluation = enabled;
+    InvalidatePlan();
+}
+
+void NodeEditorManager::SetPointwiseFusion(bool enabled)
+{
+    if (enabled == m_PointwiseFusion)
+        return;
+
+    // Like streaming: fused nodes kept no output, rebuilding the plan re-runs them
+    m_PointwiseFusion = enabled;
+    InvalidatePlan();
+}
+
+bool NodeEditorManager::IsTileable(Node* node) const
+{
+    // Extra inputs are only read at the pixel being computed, so they need no halo
+    const int halo = node->GetInputHalo();
+    return !node->Inputs.empty() && node->Outputs.size() == 1 && halo >= 0 && (node->Inputs.size() == 1 || halo == 0);
+}
+
+bool NodeEditorManager::IsPointwise(Node* node) const
+{
+    return IsTileable(node) && node->GetInputHalo() == 0;
+}
+
+bool NodeEditorManager::CanJoinChain(int producer, int consumer)
+{
+    Node* from = m_ExecutionPlan[producer].Node;
+    Node* to = m_ExecutionPlan[consumer].Node;
+    const bool tiled = (m_TiledEvaluation || m_StreamingEvaluation) && IsTileable(from) && IsTileable(to);
+    const bool fused = m_PointwiseFusion && IsPointwise(from) && IsPointwise(to);
+    if (!tiled && !fused)
+        return false;
+
+    // The chain flows through the consumer's first input, its other inputs are read
+    // from the images their producers published
+    for (Link* link : GetLinksForPin(to->Inputs[0].ID))
+    {
+        if (PinIdLayout::NodeId(link->StartPinID) == (uint64_t)from->ID.Get())
+            return true;
+    }
+    return false;
+}
+
+void NodeEditorManager::EvaluateChain(Evaluation* evaluation, const std::vector<int>& chain)
+{
+    const EvaluationContext& context = evaluation->Context;
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+
+    // Leading nodes with nothing new to compute keep their results. Once one node
+    // runs, everything after it sees a new input version and runs as well.
+    size_t first = 0;
+    while (first < chain.size() && !evaluation->Dirty[chain[first]] && !InputsChanged(m_ExecutionPlan[chain[first]].Node))
+        first++;
+    if (first == chain.size() || context.IsCancelled())
+        return;
+
+    // A streamed node kept nothing, so the chain restarts at the last node whose
+    // input still exists
+    while (first > 0 && m_ExecutionPlan[chain[first - 1]].Node->OutputStreamed)
+        first--;
+
+    const std::vector<int> steps(chain.begin() + first, chain.end());
+    const int count = (int)steps.size();
+    std::vector<Node*> nodes(count);
+    for (int k = 0; k < count; k++)
+        nodes[k] = m_ExecutionPlan[steps[k]].Node;
+
+    // The other inputs of the members, read at the same pixels as the chain's image.
+    // Whatever would need resampling first is left to Process().
+    cv::Mat input = dataManager.GetImageData(nodes[0]->Inputs[0].ID);
+    std::vector<std::vector<cv::Mat>> sides(count);
+    bool sidesMatch = true;
+    for (int k = 0; k < count; k++)
+    {
+        for (size_t j = 1; j < nodes[k]->Inputs.size(); j++)
+        {
+            sides[k].push_back(dataManager.GetImageData(nodes[k]->Inputs[j].ID));
+            sidesMatch &= !sides[k].back().empty() && sides[k].back().size() == input.size();
+        }
+    }
+
+    if (sidesMatch && evaluation->RegionRequest[steps.back()])
+    {
+        EvaluateRegion(evaluation, steps, sides);
+        return;
+    }
+
+    // Pointwise nodes feeding another pointwise node are fused with it: their output
+    // only ever exists one tile at a time, in cache, and is never written out whole
+    std::vector<char> fused(count, 0);
+    bool anyFused = false;
+    for (int k = 0; evaluation->Fusion && k < count - 1; k++)
+    {
+        fused[k] = IsPointwise(nodes[k]) && IsPointwise(nodes[k + 1]);
+        anyFused |= fused[k] != 0;
+    }
+
+    // Nothing worth splitting: the nodes run one after the other as usual
+    const bool smallImage = input.cols <= TileSize && input.rows <= TileSize;
+    if (count == 1 || input.empty() || !sidesMatch ||
+        (!anyFused && (smallImage || (!evaluation->Tiled && !evaluation->Streaming))))
+    {
+        for (int index : steps)
+        {
+            if (EvaluateStep(evaluation, index))
+            {
+                evaluation->Ran[index] = 1;
+                evaluation->Processed++;
+            }
+        }
+        return;
+    }
+
+    if (evaluation->Streaming && !smallImage)
+    {
+        StreamChain(evaluation, steps, nodes, sides, input);
+        return;
+    }
+
+    // Margin around a tile that node k has to produce so that the nodes after it
+    // can still compute the whole tile. Neighboring tiles recompute these margins.
+    std::vector<int> margin(count, 0);
+    for (int k = count - 2; k >= 0; k--)
+        margin[k] = margin[k + 1] + nodes[k + 1]->GetInputHalo();
+
+    // Square tiles, or when only fusing, bands of whole rows
+    const cv::Rect imageRect(0, 0, input.cols, input.rows);
+    const cv::Size tileSize = evaluation->Tiled ? cv::Size(TileSize, TileSize) : cv::Size(input.cols, EvaluationContext::RowBandHeight);
+    std::vector<cv::Rect> tiles;
+    for (int y = 0; y < input.rows; y += tileSize.height)
+    {
+        for (int x = 0; x < input.cols; x += tileSize.width)
+            tiles.push_back(cv::Rect(cv::Point(x, y), tileSize) & imageRect);
+    }
+
+    // Fused nodes only get a preview, sampled from every tile as it passes
+    const cv::Size previewSize = GetPreviewSize(input.size());
+    std::vector<int> previewSourceX(previewSize.width), previewSourceY(previewSize.height);
+    for (int x = 0; x < previewSize.width; x++)
+        previewSourceX[x] = std::min(input.cols - 1, (int)((x + 0.5) * input.cols / previewSize.width));
+    for (int y = 0; y < previewSize.height; y++)
+        previewSourceY[y] = std::min(input.rows - 1, (int)((y + 0.5) * input.rows / previewSize.height));
+
+    auto samplePreview = [&](cv::Mat& preview, const cv::Mat& target, const cv::Rect& targetRect, const cv::Rect& tile)
+    {
+        const size_t pixelSize = target.elemSize();
+        for (int y = 0; y < previewSize.height; y++)
+        {
+            if (previewSourceY[y] < tile.y || previewSourceY[y] >= tile.y + tile.height)
+                continue;
+
+            for (int x = 0; x < previewSize.width; x++)
+            {
+                if (previewSourceX[x] >= tile.x && previewSourceX[x] < tile.x + tile.width)
+                    memcpy(preview.ptr(y, x), target.ptr(previewSourceY[y] - targetRect.y, previewSourceX[x] - targetRect.x), pixelSize);
+            }
+        }
+    };
+
+    // Each tile runs through the whole chain while its buffers are still in cache.
+    // Only the tile itself is kept from every node that is not fused: those nodes still
+    // publish full images, for their previews and their consumers.
+    std::vector<cv::Mat> results(count);
+    std::vector<cv::Mat> previews(count);
+    auto processTile = [&](const cv::Rect& tile)
+    {
+        const auto tileStart = std::chrono::steady_clock::now();
+
+        // 'source' holds 'sourceRect' of the image; the first node reads the input itself.
+        // Margins are clipped at the image border, where the filters extrapolate exactly
+        // as they would on the whole image.
+        cv::Mat source = input;
+        cv::Rect sourceRect = imageRect;
+        for (int k = 0; k < count; k++)
+        {
+            cv::Rect targetRect = cv::Rect(tile.x - margin[k], tile.y - margin[k],
+                tile.width + 2 * margin[k], tile.height + 2 * margin[k]) & imageRect;
+
+            cv::Mat target;
+            ProcessNodeTile(nodes[k], source(targetRect - sourceRect.tl()), sides[k], targetRect, target);
+
+            // Output types are only known once a tile ran; the first tile runs alone
+            if (fused[k])
+            {
+                if (previews[k].empty())
+                    previews[k].create(previewSize, target.type());
+                samplePreview(previews[k], target, targetRect, tile);
+            }
+            else
+            {
+                if (results[k].empty())
+                    results[k].create(input.size(), target.type());
+                cv::Mat resultTile = results[k](tile);
+                target(tile - targetRect.tl()).copyTo(resultTile);
+            }
+
+            source = target;
+            sourceRect = targetRect;
+        }
+
+        // Tiles of images paged to scratch files run as fast as their pages come in
+        const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - tileStart).count();
+        evaluation->TileNanoseconds += nanoseconds;
+        evaluation->TileBytes += (int64_t)tile.area() * (int64_t)input.elemSize();
+        int64_t slowest = evaluation->SlowestTileNanoseconds.load();
+        while (nanoseconds > slowest && !evaluation->SlowestTileNanoseconds.compare_exchange_weak(slowest, nanoseconds))
+        {
+        }
+    };
+
+    processTile(tiles[0]);
+
+    // Spread the other tiles across the pool and help until they are done
+    std::atomic<int> remaining{ (int)tiles.size() - 1 };
+    for (size_t t = 1; t < tiles.size(); t++)
+    {
+        m_ThreadPool->Submit([&, t]
+        {
+            if (!context.IsCancelled())
+                processTile(tiles[t]);
+
+            // Last access to this frame's locals
+            remaining.fetch_sub(1);
+        });
+    }
+    m_ThreadPool->RunUntil([&remaining] { return remaining.load() == 0; });
+
+    if (context.IsCancelled())
+        return;
+
+    // Hand the results over in chain order, so every node consumes the version its
+    // predecessor just produced
+    cv::Mat nodeInput = input;
+    size_t bytesSaved = 0;
+    int fusedNodes = 0;
+    for (int k = 0; k < count; k++)
+    {
+        if (fused[k])
+        {
+            // Consumers must not see the output of an earlier evaluation. Every pixel
+            // of it would have been written once and read back once by the next node.
+            for (auto& output : nodes[k]->Outputs)
+                dataManager.ClearImageData(output.ID);
+            nodes[k]->SetStreamedResult(previews[k]);
+            nodes[k]->OutputStreamed = true;
+            bytesSaved += 2 * input.total() * previews[k].elemSize();
+            fusedNodes++;
+            nodeInput = cv::Mat();
+        }
+        else
+        {
+            nodes[k]->SetTiledResult(nodeInput, results[k]);
+            nodes[k]->OutputStreamed = false;
+            nodeInput = results[k];
+        }
+        CompleteChainStep(evaluation, steps[k]);
+    }
+
+    evaluation->TiledNodes += count;
+    evaluation->Tiles += (int)tiles.size();
+    evaluation->FusedNodes += fusedNodes;
+    evaluation->FusionBytesSaved += bytesSaved;
+}
+
+void NodeEditorManager::StreamChain(Evaluation* evaluation, const std::vector<int>& steps, const std::vector<Node*>& nodes,
+    const std::vector<std::vector<cv::Mat>>& sides, const cv::Mat& input)
+{
+    const EvaluationContext& context = evaluation->Context;
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+    const int count = (int)nodes.size();
+    const int rows = input.rows;
+
+    // Rows are pulled from the input one at a time and pushed through the chain. Node k
+    // (k > 0) sees its input through a line buffer just tall enough for its kernel, so
+    // the intermediates take the image width times the kernel heights. The chain's
+    // input and the last node's output are whole images all the same: peak memory is
+    // two images plus the line buffers, against one image per node without streaming.
+    std::vector<int> halo(count);
+    for (int k = 0; k < count; k++)
+        halo[k] = nodes[k]->GetInputHalo();
+
+    std::vector<LineBuffer> lines(count);
+    std::vector<int> nextRow(count, 0);
+
+    // The last node's output is kept whole: it is the image OutputNode shows and saves,
+    // filled in row by row. The inner nodes only keep a row-sampled preview.
+    cv::Mat result;
+    const cv::Size previewSize = GetPreviewSize(input.size());
+    std::vector<cv::Mat> previews(count);
+    std::vector<int> nextPreviewRow(count, 0);
+    auto previewSourceRow = [&](int previewRow)
+    {
+        return std::min(rows - 1, (int)((previewRow + 0.5) * rows / previewSize.height));
+    };
+
+    // Compute row y of node k. Its window of input rows is a standalone image, so the
+    // filters extrapolate past it exactly where they would at the image border.
+    int pulledRows = 0;
+    std::function<void(int)> drain;
+    auto emitRow = [&](int k, int y)
+    {
+        const int firstRow = std::max(0, y - halo[k]);
+        const int endRow = std::min(rows, y + halo[k] + 1);
+        cv::Mat window = (k == 0)
+            ? cv::Mat(endRow - firstRow, input.cols, input.type(), const_cast<uchar*>(input.ptr(firstRow)), input.step)
+            : lines[k].Window(firstRow, endRow);
+
+        cv::Mat row;
+        ProcessNodeTile(nodes[k], window.row(y - firstRow), sides[k], cv::Rect(0, y, input.cols, 1), row);
+
+        if (k == count - 1)
+        {
+            if (result.empty())
+                result.create(input.size(), row.type());
+            cv::Mat resultRow = result.row(y);
+            row.copyTo(resultRow);
+            return;
+        }
+
+        while (nextPreviewRow[k] < previewSize.height && previewSourceRow(nextPreviewRow[k]) == y)
+        {
+            if (previews[k].empty())
+                previews[k].create(previewSize, row.type());
+            cv::Mat previewRow = previews[k].row(nextPreviewRow[k]++);
+            cv::resize(row, previewRow, previewRow.size(), 0, 0, cv::INTER_AREA);
+        }
+
+        // A kernel of height 2 * halo + 1 is all the next node ever looks at
+        if (lines[k + 1].Empty())
+            lines[k + 1].Create(2 * halo[k + 1] + 1, input.cols, row.type());
+        lines[k + 1].PushRow(row);
+        drain(k + 1);
+    };
+
+    // Emit every row node k can compute from the input rows it has so far. New rows
+    // are passed on right away, so no line buffer is asked for a row it already dropped.
+    drain = [&](int k)
+    {
+        const int inputRows = (k == 0) ? pulledRows : lines[k].RowsPushed();
+        while (nextRow[k] < rows && (nextRow[k] + halo[k] < inputRows || inputRows == rows))
+            emitRow(k, nextRow[k]++);
+    };
+
+    while (pulledRows < rows)
+    {
+        if (pulledRows % EvaluationContext::RowBandHeight == 0 && context.IsCancelled())
+            return;
+
+        pulledRows++;
+        drain(0);
+    }
+
+    if (context.IsCancelled())
+        return;
+
+    size_t lineBufferBytes = 0;
+    for (int k = 0; k < count; k++)
+    {
+        if (k < count - 1)
+        {
+            // Consumers must not see the output of an earlier evaluation
+            for (auto& output : nodes[k]->Outputs)
+                dataManager.ClearImageData(output.ID);
+            nodes[k]->SetStreamedResult(previews[k]);
+            nodes[k]->OutputStreamed = true;
+        }
+        else
+        {
+            // The last node's input was streamed too, it never existed as a whole
+            nodes[k]->SetTiledResult(cv::Mat(), result);
+            nodes[k]->OutputStreamed = false;
+        }
+
+        CompleteChainStep(evaluation, steps[k]);
+        lineBufferBytes += lines[k].GetSizeInBytes();
+    }
+
+    evaluation->StreamedNodes += count;
+    evaluation->LineBufferBytes += lineBufferBytes;
+    evaluation->StreamedImageBytes += input.total() * input.elemSize() + result.total() * result.elemSize();
+}
+
+void NodeEditorManager::EvaluateRegion(Evaluation* evaluation, const std::vector<int>& steps, const std::vector<std::vector<cv::Mat>>& sides)
+{
+    const EvaluationContext& context = evaluation->Context;
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+
+    // The last step requests the region, the ones before it compute it
+    const int count = (int)steps.size() - 1;
+    Node* requester = m_ExecutionPlan[steps.back()].Node;
+    Node* head = m_ExecutionPlan[steps.front()].Node;
+
+    cv::Mat input = dataManager.GetImageData(head->Inputs[0].ID);
+    cv::Rect region;
+    if (count == 0 || input.empty() || !requester->GetRequestedRegion(input.size(), region))
+    {
+        // Nothing to narrow down, evaluate the whole images as usual
+        for (int index : steps)
+        {
+            if (EvaluateStep(evaluation, index))
+            {
+                evaluation->Ran[index] = 1;
+                evaluation->Processed++;
+            }
+        }
+        return;
+    }
+
+    // Map the region back through the footprint of every node: node k has to produce
+    // it grown by the halos of all nodes after it (clipped at the image border, where
+    // the filters extrapolate as they would on the whole image)
+    std::vector<Node*> nodes(count);
+    for (int k = 0; k < count; k++)
+        nodes[k] = m_ExecutionPlan[steps[k]].Node;
+
+    std::vector<int> margin(count, 0);
+    for (int k = count - 2; k >= 0; k--)
+        margin[k] = margin[k + 1] + nodes[k + 1]->GetInputHalo();
+
+    const cv::Rect imageRect(0, 0, input.cols, input.rows);
+    std::vector<cv::Mat> regions(count);
+    cv::Mat source = input;
+    cv::Rect sourceRect = imageRect;
+    for (int k = 0; k < count; k++)
+    {
+        if (context.IsCancelled())
+            return;
+
+        cv::Rect targetRect = cv::Rect(region.x - margin[k], region.y - margin[k],
+            region.width + 2 * margin[k], region.height + 2 * margin[k]) & imageRect;
+
+        cv::Mat target;
+        ProcessNodeTile(nodes[k], source(targetRect - sourceRect.tl()), sides[k], targetRect, target);
+        regions[k] = target(region - targetRect.tl());
+
+        source = target;
+        sourceRect = targetRect;
+    }
+
+    // Upstream nodes keep no full output either, their previews show the region
+    for (int k = 0; k < count; k++)
+    {
+        for (auto& output : nodes[k]->Outputs)
+            dataManager.ClearImageData(output.ID);
+        nodes[k]->SetStreamedResult(regions[k]);
+        nodes[k]->OutputStreamed = true;
+        CompleteChainStep(evaluation, steps[k]);
+    }
+
+    requester->SetRegionResult(regions.back());
+    requester->OutputStreamed = false;
+    CompleteChainStep(evaluation, steps.back());
+
+    evaluation->RegionNodes += count;
+    evaluation->RegionPixels += (int64_t)region.area();
+}
+
+void NodeEditorManager::CompleteChainStep(Evaluation* evaluation, int index)
+{
+    // Finish a node evaluated as part of a chain like EvaluateStep() does after Process()
+    Node* node = m_ExecutionPlan[index].Node;
+    ImageDataManager& dataManager = ImageDataManager::GetInstance();
+
+    node->PreparePreview();
+    node->ComputedOutputs = node->RequestedOutputs;
+    node->OutputEvicted = false;
+    StoreResults(evaluation, index);
+
+    for (auto& pin : node->Inputs)
+        pin.ConsumedVersion = dataManager.GetInputVersion(pin.ID);
+    for (auto& output : node->Outputs)
+        dataManager.BumpVersion(output.ID);
+
+    evaluation->Ran[index] = 1;
+    evaluation->Processed++;
+}
+
+void NodeEditorManager::PublishFocusedResults()
+{
+    // Every prioritized step finished, the rest of the evaluation is still running. The
+    // workers no longer touch these nodes: consumers read their outputs from the
+    // ImageDataManager, and only duplicates read the nodes themselves. A node copied by
+    // a duplicate that may still be waiting is left to FinishEvaluation().
+    Evaluation* evaluation = m_Evaluation.get();
+    evaluation->FocusPublished = true;
+
+    const int stepCount = (int)evaluation->Nodes.size();
+    bool published = false;
+    for (int i = 0; i < stepCount; i++)
+    {
+        if (evaluation->Priority[i] == PriorityBackground || !evaluation->Ran[i] || evaluation->Nodes[i].use_count() == 1)
+            continue;
+
+        bool duplicatesDone = true;
+        for (int duplicate : evaluation->Duplicates[i])
+            duplicatesDone = duplicatesDone && evaluation->Priority[duplicate] != PriorityBackground;
+        if (!duplicatesDone)
+            continue;
+
+        evaluation->Nodes[i]->PublishResults();
+        evaluation->Published[i] = 1;
+        published = true;
+    }
+
+    if (published)
+    {
+        evaluation->FocusMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - evaluation->StartTime).count();
+    }
+}
+
+void NodeEditorManager::FinishEvaluation()
+{
+    std::unique_ptr<Evaluation> evaluation = std::move(m_Evaluation);
+    const int stepCount = (int)evaluation->Nodes.size();
+
+    for (int i = 0; i < stepCount; i++)
+    {
+        Node* node = evaluation->Nodes[i].get();
+
+        // Nodes deleted while the evaluation was running are only kept alive by it,
+        // drop whatever they published. They are destroyed here, on the UI thread.
+        if (evaluation->Nodes[i].use_count() == 1)
+        {
+            for (auto& output : node->Outputs)
+                ImageDataManager::GetInstance().ClearImageData(output.ID);
+            continue;
+        }
+
+        // Swap in the new results and create preview textures (UI thread only).
+        // Nodes that completed before a cancellation are kept as well.
+        if (evaluation->Ran[i] && !evaluation->Published[i])
+            node->PublishResults();
+        else if (evaluation->Dirty[i] && evaluation->Context.IsCancelled())
+            node->SetDirty(true); // Never got to see its edit, retry with the latest parameters
+    }
+
+    const double scale = evaluation->Context.GetProxyScale();
+    if (evaluation->Processed > 0)
+        m_EvaluationStats.ProxyScale = scale;
+
+    // Cancelled evaluations leave work behind for the next one, and are not timed:
+    // the latency that counts is the one of the edit that superseded them
+    if (evaluation->Context.IsCancelled())
+    {
+        m_ResumeCancelledWork = true;
+        m_EvaluationStats.CancelledEvaluations++;
+        return;
+    }
+
+    // Only record evaluations that did work, idle frames keep the last edit's numbers
+    int processed = evaluation->Processed;
+    if (processed > 0)
+    {
+        m_EvaluationStats.NodesProcessed = processed;
+        m_EvaluationStats.NodesSkipped = stepCount - processed;
+        m_EvaluationStats.DeadNodes = (int)std::count(evaluation->Live.begin(), evaluation->Live.end(), 0);
+        m_EvaluationStats.MergedNodes = evaluation->MergedNodes;
+        m_EvaluationStats.SkippedOutputs = evaluation->SkippedOutputs;
+        m_EvaluationStats.Evaluations++;
+        m_EvaluationStats.TotalNodesProcessed += processed;
+        m_EvaluationStats.TiledNodes = evaluation->TiledNodes;
+        m_EvaluationStats.Tiles = evaluation->Tiles;
+        const double tileSeconds = evaluation->TileNanoseconds * 1e-9;
+        m_EvaluationStats.TileMs = evaluation->Tiles > 0 ? tileSeconds * 1000.0 / evaluation->Tiles : 0.0;
+        m_EvaluationStats.SlowestTileMs = evaluation->SlowestTileNanoseconds * 1e-6;
+        m_EvaluationStats.TileThroughputMBps = tileSeconds > 0.0 ? evaluation->TileBytes / tileSeconds / (1024.0 * 1024.0) : 0.0;
+        m_EvaluationStats.StreamedNodes = evaluation->StreamedNodes;
+        m_EvaluationStats.LineBufferBytes = evaluation->LineBufferBytes;
+        m_EvaluationStats.StreamedImageBytes = evaluation->StreamedImageBytes;
+        m_EvaluationStats.RegionNodes = evaluation->RegionNodes;
+        m_EvaluationStats.RegionPixels = evaluation->RegionPixels;
+        m_EvaluationStats.FusedNodes = evaluation->FusedNodes;
+        m_EvaluationStats.FusionBytesSaved = evaluation->FusionBytesSaved;
+        m_EvaluationStats.CacheHits = evaluation->CacheHits;
+        m_EvaluationStats.CacheMisses = evaluation->CacheMisses;
+        m_EvaluationStats.DiskCacheHits = evaluation->DiskCacheHits;
+        m_EvaluationStats.RecomputedNodes = evaluation->RecomputedNodes;
+        m_EvaluationStats.LastEvaluationMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - evaluation->StartTime).count();
+        m_EvaluationStats.FocusMs = evaluation->FocusMs > 0 ? evaluation->FocusMs : m_EvaluationStats.LastEvaluationMs;
+        m_FullResolutionCostMs = m_EvaluationStats.LastEvaluationMs / (scale * scale);
+    }
+}
+
+void NodeEditorManager::WaitForEvaluation()
+{
+    if (!m_Evaluation)
+        return;
+
+    // Help the workers instead of sleeping
+    Evaluation* evaluation = m_Evaluation.get();
+    m_ThreadPool->RunUntil([evaluation] { return evaluation->Pending.load() == 0; });
+    FinishEvaluation();
+}
+
+void NodeEditorManager::SyncAllNodes()
+{
+    // Mark all nodes as dirty, the next ProcessNodes() re-evaluates everything
+    for (auto& node : m_Nodes)
+    {
+        node->SetDirty(true);
+    }
 }
 
 void NodeEditorManager::HandleCreation()
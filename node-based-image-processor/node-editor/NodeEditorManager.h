@@ -1,9 +1,14 @@
 #pragma once
 
 #include "Node.h"
+#include "ThreadPool.h"
+#include "ResultCache.h"
+#include "DiskResultCache.h"
 #include <unordered_map>
-#include <deque>
 #include <functional>
+#include <chrono>
+#include <queue>
+#include <tuple>
 
 // Forward declaration to solve circular dependencies
 class NodeEditorManager;
@@ -24,6 +29,39 @@ struct Link
     }
 };
 
+// Describes the most recent evaluation that actually recomputed something
+struct EvaluationStats
+{
+    int NodesProcessed = 0;      // Nodes recomputed by the last edit
+    int NodesSkipped = 0;        // Nodes left untouched by the last edit
+    int DeadNodes = 0;           // Nodes not evaluated at all: no output or visible preview depends on them
+    int MergedNodes = 0;         // Nodes sharing the results of an identical node instead of computing them
+    int SkippedOutputs = 0;      // Outputs of live multi-output nodes left uncomputed, nothing reads them
+    uint64_t Evaluations = 0;    // Number of evaluations that recomputed at least one node
+    uint64_t TotalNodesProcessed = 0;
+    double LastEvaluationMs = 0; // Wall time of the last evaluation, from start to results shown
+    double FocusMs = 0;          // Until the selected node and the previews on screen showed theirs
+    uint64_t CancelledEvaluations = 0; // Evaluations abandoned because a newer edit superseded them
+    int TiledNodes = 0;          // Nodes of the last evaluation that ran tile by tile
+    int Tiles = 0;               // Tiles those nodes were split into
+    double TileMs = 0;           // Average time a tile took through its whole chain
+    double SlowestTileMs = 0;    // Longest one, tiles waiting for pages of mapped images show here
+    double TileThroughputMBps = 0; // Input bytes per second of tile time, per thread
+    int StreamedNodes = 0;       // Nodes of the last evaluation that ran row by row
+    size_t LineBufferBytes = 0;  // Memory their line buffers took, in place of the intermediate images
+    size_t StreamedImageBytes = 0; // Whole images they still held: each chain's input and output
+    int RegionNodes = 0;         // Nodes of the last evaluation that only computed a requested region
+    int64_t RegionPixels = 0;    // Pixels in that region
+    int FusedNodes = 0;          // Pointwise nodes of the last evaluation fused into their consumer
+    size_t FusionBytesSaved = 0; // Memory traffic that saved: their outputs were never written and read back
+    int CacheHits = 0;           // Nodes of the last evaluation whose results came from the result cache
+    int CacheMisses = 0;         // Nodes of the last evaluation that ran and stored their results in it
+    int DiskCacheHits = 0;       // Cache hits of the last evaluation loaded from the disk cache
+    int RecomputedNodes = 0;     // Nodes of the last evaluation re-run because their evicted outputs were read
+    uint64_t Evictions = 0;      // Nodes whose outputs were evicted to fit the memory budget
+    double ProxyScale = 1.0;     // Resolution of the results shown, below 1 for proxies
+};
+
 class NodeEditorManager
 {
 public:
@@ -34,9 +72,69 @@ public:
     void Shutdown();
 
     void Render();
+    // Starts evaluating the graph in the background when something changed, and shows the
+    // results of a finished evaluation. Never waits for the evaluation itself.
     void ProcessNodes();
     void SyncAllNodes();
 
+    // True while a background evaluation is running
+    bool IsEvaluating() const { return m_Evaluation != nullptr; }
+
+    // Threads evaluating the graph. The same pool runs OpenCV's parallel loops (see
+    // ThreadPoolParallelBackend), so nodes running concurrently never start more
+    // threads than this. 0 sizes it to the machine, leaving a core to the UI thread.
+    // Waits for the running evaluation.
+    void SetThreadCount(unsigned count);
+    unsigned GetThreadCount() const { return m_ThreadPool->GetThreadCount(); }
+
+    // Evaluate chains of neighborhood operations tile by tile (see EvaluateChain)
+    void SetTiledEvaluation(bool enabled) { m_TiledEvaluation = enabled; }
+    bool IsTiledEvaluation() const { return m_TiledEvaluation; }
+
+    // Stream chains row by row instead, without keeping their intermediate images
+    // (see StreamChain). Meant for images too large to hold one copy per node; the
+    // chain's input and its last node's output are still whole images.
+    void SetStreamingEvaluation(bool enabled);
+    bool IsStreamingEvaluation() const { return m_StreamingEvaluation; }
+
+    // Fuse runs of pointwise nodes into one pass over the image that keeps none of
+    // their intermediate images (see EvaluateChain)
+    void SetPointwiseFusion(bool enabled);
+    bool IsPointwiseFusion() const { return m_PointwiseFusion; }
+
+    // While a widget is dragged, evaluate edits on downscaled proxies of the inputs,
+    // at the largest scale expected to fit the latency budget. Releasing the widget
+    // refines the results at full resolution.
+    void SetProxyResolution(bool enabled) { m_ProxyResolution = enabled; }
+    bool IsProxyResolution() const { return m_ProxyResolution; }
+    void SetProxyBudgetMs(float budgetMs) { m_ProxyBudgetMs = budgetMs; }
+    float GetProxyBudgetMs() const { return m_ProxyBudgetMs; }
+
+    // Results of earlier evaluations, found again when a node goes back to parameters
+    // and inputs it was evaluated with before (see ComputeCacheKeys)
+    ResultCache& GetResultCache() { return m_ResultCache; }
+    // Keeps full-resolution results in a directory as well, to find them again in later
+    // sessions. An empty directory turns the disk cache off.
+    void SetDiskCache(const std::string& directory, size_t capacityBytes);
+    DiskResultCache* GetDiskCache() { return m_DiskCache.get(); }
+
+    // Once the images published or held by nodes take more than the budget, the least recently used
+    // intermediates are evicted, and recomputed if anything reads them again
+    // (see EnforceMemoryBudget). 0 means no budget.
+    void SetMemoryBudget(size_t bytes);
+    size_t GetMemoryBudget() const { return m_MemoryBudget; }
+    size_t GetMemoryUsage() const { return m_MemoryUsage; } // As of the last finished evaluation
+
+    // Store float intermediates in half precision, converted back to single precision
+    // for every node reading them (see ImageDataManager). Re-evaluates the graph.
+    void SetHalfPrecisionStorage(bool enabled);
+    bool IsHalfPrecisionStorage() const;
+
+    // Images no evaluation read for this many evaluations are compressed in the
+    // background while the editor is idle (see CompressColdImages). 0 turns it off.
+    void SetCompressAfter(int evaluations) { m_CompressAfter = evaluations; m_ColdImagesChanged = true; }
+    int GetCompressAfter() const { return m_CompressAfter; }
+
     // Node management
     Node* CreateNode(int nodeType, ImVec2 position = ImVec2(0, 0));
     void DeleteNode(ed::NodeId id);
@@ -51,7 +149,7 @@ public:
     // Pin management
     Pin* FindPin(ed::PinId id);
     bool IsPinLinked(ed::PinId id);
-    std::vector<Link*> GetLinksForPin(ed::PinId id);
+    const std::vector<Link*>& GetLinksForPin(ed::PinId id);
 
     // Selection management
     Node* GetSelectedNode();
@@ -66,27 +164,197 @@ public:
     // Access to node editor context
     ed::EditorContext* GetEditorContext() const { return m_EditorContext; }
 
+    // Statistics about how much of the graph the last edit recomputed
+    const EvaluationStats& GetEvaluationStats() const { return m_EvaluationStats; }
+
 private:
     // Node editor context
     ed::EditorContext* m_EditorContext = nullptr;
 
-    // Graph data
-    std::vector<std::unique_ptr<Node>> m_Nodes;
+    // Graph data (shared so that a running evaluation keeps deleted nodes alive)
+    std::vector<std::shared_ptr<Node>> m_Nodes;
     std::vector<std::unique_ptr<Link>> m_Links;
 
-    // Cache for quick lookups
-    std::unordered_map<uint64_t, Node*> m_NodeMap; // Map of NodeId -> Node*
-    std::unordered_map<uint64_t, Link*> m_LinkMap; // Map of LinkId -> Link*
+    // Cache for quick lookups (pin -> node is decoded from the pin ID, see PinIdLayout).
+    // The index into m_Nodes/m_Links lets deletion swap the last element into the gap.
+    struct NodeEntry { Node* Ptr = nullptr; size_t Index = 0; };
+    struct LinkEntry { Link* Ptr = nullptr; size_t Index = 0; };
+    std::unordered_map<uint64_t, NodeEntry> m_NodeMap; // Map of NodeId -> node
+    std::unordered_map<uint64_t, LinkEntry> m_LinkMap; // Map of LinkId -> link
+    std::unordered_map<uint64_t, std::vector<Link*>> m_PinLinks; // Map of PinId -> links attached to it
+    std::unordered_map<uint64_t, std::vector<Node*>> m_NodeSuccessors; // Map of NodeId -> consumer per outgoing link
+
+    // Keep the adjacency indices in sync with m_Links
+    void IndexLink(Link* link);
+    void UnindexLink(Link* link);
 
-    // Processing queue to handle node evaluation in correct order
+    // One node of the compiled execution plan
+    struct PlanStep
+    {
+        class Node* Node;
+        int PredecessorCount = 0;     // Links feeding this node's inputs
+        std::vector<int> Successors;  // Plan indices of consumers, one entry per link
+    };
+
+    // Execution plan: nodes in topological order. Compiled lazily by ProcessNodes
+    // and kept across frames until CreateNode/DeleteNode/CreateLink/DeleteLink
+    // invalidate it.
     bool CalculateProcessingOrder();
-    std::deque<Node*> m_ProcessingQueue;
+    void InvalidatePlan();
+    std::vector<PlanStep> m_ExecutionPlan;
+    std::unordered_map<uint64_t, int> m_StepOfNode; // Node ID -> plan index
+    bool m_PlanDirty = true;
+    bool m_PlanValid = false;
+
+    // Plan steps with a path to a graph output or to a preview on screen. The others
+    // are skipped and keep their edits pending until they become live again.
+    // Idle frames only compare the roots (graph outputs, previews on screen) with the
+    // last ones, the links are walked again once they or the plan changed.
+    bool UpdateLiveness(bool planRebuilt);
+    std::vector<char> m_LiveSteps;
+    std::vector<char> m_LiveRoots;   // Steps live by themselves, as of the last walk
+    std::vector<char> m_LiveScratch; // Previous m_LiveSteps, reused by the next walk
+    uint64_t m_LiveRootsChangeCount = 0; // Node::GetChangeCount() when m_LiveRoots was computed
+
+    // What a step feeds decides when it runs: ready steps wait in a priority queue, and
+    // the results the user looks at are shown before the rest of the graph finished
+    enum StepPriority
+    {
+        PriorityBackground, // Off-screen previews, graph outputs nobody looks at
+        PriorityVisible,    // Feeds a preview on screen
+        PrioritySelected    // Feeds the selected node
+    };
+
+    // State of one background evaluation of the execution plan. The UI thread
+    // owns it; worker tasks only use it until they decrement Pending.
+    struct Evaluation
+    {
+        explicit Evaluation(size_t stepCount)
+            : Nodes(stepCount), Live(stepCount, 0), Dirty(stepCount, 0), Ran(stepCount, 0), ChainNext(stepCount, -1), ChainHead(stepCount), Canonical(stepCount, -1), Duplicates(stepCount), CacheKey(stepCount, 0), CacheHit(stepCount, 0), RegionRequest(stepCount, 0), Priority(stepCount, PriorityBackground), Published(stepCount, 0), Remaining(stepCount) {}
+
+        std::vector<std::shared_ptr<Node>> Nodes; // Plan order, keeps deleted nodes alive
+        std::vector<char> Live;                   // Steps evaluated at all, see UpdateLiveness()
+        std::vector<char> Dirty;                  // Node::IsDirty() captured when the evaluation started
+        uint64_t ChangeCount = 0;                 // Node::GetChangeCount() once it was captured
+        std::vector<char> Ran;                    // Steps whose Process() ran
+        std::vector<int> ChainNext;               // Next step of a tiled chain, or -1
+        std::vector<int> ChainHead;               // First step of the chain a step belongs to (itself if none)
+        std::vector<int> Canonical;               // Identical step whose results a step shares, or -1
+        std::vector<std::vector<int>> Duplicates; // Steps sharing the results of a step, released once it finished
+        int MergedNodes = 0;
+        int SkippedOutputs = 0;
+        std::vector<size_t> CacheKey;             // Result cache key per step, 0 if its results are not cached
+        std::vector<char> CacheHit;               // Steps whose results were in the cache when the evaluation started
+        std::atomic<int> CacheHits{ 0 };
+        std::atomic<int> CacheMisses{ 0 };
+        std::atomic<int> DiskCacheHits{ 0 };
+        int RecomputedNodes = 0;
+        std::vector<char> RegionRequest;          // Steps ending a chain that only computes their region
+        std::vector<int> Priority;                // StepPriority per step, see ComputePriorities()
+        std::mutex ReadyMutex;
+        std::priority_queue<std::tuple<int, int, int>> ReadySteps; // (priority, order readied, step) of the steps ready to run
+        int ReadyCount = 0;
+        std::atomic<int> FocusPending{ 0 };       // Steps above PriorityBackground not finished yet
+        bool FocusPublished = false;              // Their results were shown early (UI thread)
+        std::vector<char> Published;              // Steps shown early (UI thread)
+        double FocusMs = 0;                       // When they were, 0 if nothing was
+        std::vector<std::atomic<int>> Remaining;  // Unfinished predecessors per step
+        std::atomic<int> Pending{ 0 };            // Steps not finished yet
+        std::atomic<int> Processed{ 0 };
+        std::atomic<int> TiledNodes{ 0 };
+        std::atomic<int> Tiles{ 0 };
+        std::atomic<int64_t> TileNanoseconds{ 0 };        // Sum over all tiles
+        std::atomic<int64_t> SlowestTileNanoseconds{ 0 };
+        std::atomic<int64_t> TileBytes{ 0 };              // Input bytes of all tiles
+        std::atomic<int> StreamedNodes{ 0 };
+        std::atomic<size_t> LineBufferBytes{ 0 };
+        std::atomic<size_t> StreamedImageBytes{ 0 };
+        bool Tiled = false;                       // Chains are tiled
+        bool Streaming = false;                   // Chains are streamed rather than tiled
+        std::atomic<int> RegionNodes{ 0 };
+        std::atomic<int64_t> RegionPixels{ 0 };
+        bool Fusion = false;                      // Pointwise runs are fused
+        std::atomic<int> FusedNodes{ 0 };
+        std::atomic<size_t> FusionBytesSaved{ 0 };
+        std::chrono::steady_clock::time_point StartTime;
+        EvaluationContext Context;                // Cancelled once a newer edit makes the work stale
+    };
+
+    // Independent nodes of the plan run concurrently on this pool, off the UI thread
+    std::unique_ptr<ThreadPool> m_ThreadPool;
+    std::unique_ptr<Evaluation> m_Evaluation; // The running evaluation, if any
+    void StartEvaluation();
+    void MergeIdenticalNodes(Evaluation* evaluation); // Common subexpression elimination
+    void RequestOutputs(Evaluation* evaluation);
+    void ComputeCacheKeys(Evaluation* evaluation);
+    void RecomputeEvictedInputs(Evaluation* evaluation);
+    void ComputePriorities(Evaluation* evaluation);
+    void ScheduleSteps(Evaluation* evaluation, const int* steps, int count);
+    void RunReadyStep(Evaluation* evaluation);
+    void PublishFocusedResults();
+    void StoreResults(Evaluation* evaluation, int index);
+    void RunStep(Evaluation* evaluation, int index);
+    bool EvaluateStep(Evaluation* evaluation, int index);
+    void EvaluateChain(Evaluation* evaluation, const std::vector<int>& chain);
+    void StreamChain(Evaluation* evaluation, const std::vector<int>& steps, const std::vector<Node*>& nodes,
+        const std::vector<std::vector<cv::Mat>>& sides, const cv::Mat& input);
+    void EvaluateRegion(Evaluation* evaluation, const std::vector<int>& steps, const std::vector<std::vector<cv::Mat>>& sides);
+    void CompleteChainStep(Evaluation* evaluation, int index);
+    bool IsTileable(Node* node) const;
+    bool IsPointwise(Node* node) const;
+    bool CanJoinChain(int producer, int consumer);
+    bool m_TiledEvaluation = true;
+    bool m_StreamingEvaluation = false;
+    bool m_PointwiseFusion = true;
+    static constexpr size_t DefaultResultCacheBytes = 512ull * 1024 * 1024;
+    ResultCache m_ResultCache{ DefaultResultCacheBytes };
+    std::unique_ptr<DiskResultCache> m_DiskCache; // Null unless enabled
+
+    // Memory budget of the published images and those nodes hold (UI thread only)
+    void EnforceMemoryBudget();
+    bool IsEvictable(Node* node);
+    size_t MeasureMemoryUsage();
+    std::vector<cv::Mat> m_HeldImages; // Scratch of MeasureMemoryUsage()
+    static constexpr size_t DefaultMemoryBudget = 8ull * 1024 * 1024 * 1024;
+    size_t m_MemoryBudget = DefaultMemoryBudget;
+    size_t m_MemoryUsage = 0;
+
+    void CompressColdImages();
+    // Treats outputs whose compressed copy was corrupt as evicted (see ImageDataManager::TakeLostOutputPins)
+    void RecoverLostOutputs();
+    int m_CompressAfter = 3;
+    bool m_ColdImagesChanged = true; // Images aged or the graph changed since the last search
+    std::atomic<int> m_CompressionsInFlight{ 0 };
+
+    // Content hashes of sources, computed on the pool before an evaluation needs them
+    bool PrepareContentHashes();
+    std::atomic<int> m_ContentHashesInFlight{ 0 };
+
+    // Proxy resolution while dragging (see ProcessNodes)
+    double ChooseProxyScale() const;
+    bool m_ProxyResolution = true;
+    float m_ProxyBudgetMs = 30.0f;
+    double m_ProxyScale = 1.0;           // Scale the next evaluation runs at
+    double m_FullResolutionCostMs = 0.0; // Last edit's cost, extrapolated to full resolution
+    static constexpr double MinProxyScale = 1.0 / 8.0;
+    // Tiles are sized so that a tile and its halo stay in L2 through a whole chain
+    static constexpr int TileSize = 256;
+    void FinishEvaluation();
+    void WaitForEvaluation();
+    bool IsEvaluationSuperseded() const;
+    bool m_ResumeCancelledWork = false; // The last evaluation was cancelled, finish its leftovers
+    uint64_t m_IdleChangeCount = 0; // Node::GetChangeCount() on the last frame that found no work
     int m_NextId = 1;
 
+    // A node needs to run if it was edited or any of its inputs changed version
+    bool InputsChanged(Node* node) const;
+    EvaluationStats m_EvaluationStats;
+
     // Handle interaction
     void HandleCreation();
     void HandleDeletion();
 
     // For detecting selection changes
     ed::NodeId m_SelectedNodeId;
+    std::vector<ed::NodeId> m_SelectionScratch; // Reused every frame
 };
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "ParallelBackend.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+ThreadPoolParallelBackend::ThreadPoolParallelBackend(ThreadPool& pool)
+    : m_Pool(pool), m_ThreadCount((int)pool.GetThreadCount() + 1)
+{
+}
+
+void ThreadPoolParallelBackend::parallel_for(int tasks, FN_parallel_for_body_cb_t body, void* data)
+{
+    const int threads = std::min(tasks, m_ThreadCount.load());
+    if (threads <= 1)
+    {
+        body(0, tasks, data);
+        return;
+    }
+
+    // Stripes are claimed one at a time, by the calling thread and by 'threads - 1'
+    // helpers. A helper that starts after the last stripe was claimed finds nothing
+    // left to do, so only claimed stripes are waited for; the state is shared with
+    // helpers that may still be queued when this returns.
+    struct LoopState
+    {
+        std::atomic<int> NextTask{ 0 };
+        std::atomic<int> FinishedTasks{ 0 };
+        std::mutex Mutex;
+        std::condition_variable Finished;
+    };
+    auto state = std::make_shared<LoopState>();
+    auto runTasks = [state, tasks, body, data]
+    {
+        for (int task = state->NextTask.fetch_add(1); task < tasks; task = state->NextTask.fetch_add(1))
+        {
+            body(task, task + 1, data);
+            if (state->FinishedTasks.fetch_add(1) + 1 == tasks)
+            {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                state->Finished.notify_all();
+            }
+        }
+    };
+
+    for (int i = 0; i < threads - 1; i++)
+        m_Pool.Submit(runTasks);
+    runTasks();
+
+    // Workers run other tasks while they wait. Any other thread (the UI thread above all)
+    // must not pick up a whole node that way, it only waits for the stripes in flight.
+    if (m_Pool.GetCurrentWorkerIndex() >= 0)
+    {
+        m_Pool.RunUntil([&state, tasks] { return state->FinishedTasks.load() == tasks; });
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(state->Mutex);
+        state->Finished.wait(lock, [&state, tasks] { return state->FinishedTasks.load() == tasks; });
+    }
+}
+
+int ThreadPoolParallelBackend::getThreadNum() const
+{
+    // Threads outside the pool (the UI thread, embedding code) share number 0
+    return m_Pool.GetCurrentWorkerIndex() + 1;
+}
+
+int ThreadPoolParallelBackend::getNumThreads() const
+{
+    return m_ThreadCount.load();
+}
+
+int ThreadPoolParallelBackend::setNumThreads(int threadCount)
+{
+    // Negative restores the default, like OpenCV's own backends
+    const int poolThreads = (int)m_Pool.GetThreadCount() + 1;
+    const int count = threadCount < 0 ? poolThreads : std::max(1, std::min(threadCount, poolThreads));
+    return m_ThreadCount.exchange(count);
+}
+
+void ThreadPoolParallelBackend::Install(ThreadPool* pool)
+{
+    if (pool)
+        cv::parallel::setParallelForBackend(std::make_shared<ThreadPoolParallelBackend>(*pool), false);
+    else
+        cv::parallel::setParallelForBackend(std::shared_ptr<cv::parallel::ParallelForAPI>(), false);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#include <atomic>
+
+// Runs OpenCV's own parallel loops (inside filter2D, cvtColor, Canny...) on the
+// evaluation thread pool instead of a second set of threads.
+//
+// Without it every worker running a node can start one OpenCV loop that wants all
+// cores for itself, and the machine runs the graph's threads times OpenCV's. Here a
+// loop splits its stripes between the calling thread and helper tasks queued on the
+// pool: a busy pool simply leaves the stripes to the caller, an idle one spreads them.
+// A worker waiting for the stripes its helpers took runs other queued tasks meanwhile,
+// so nesting never blocks a worker.
+class ThreadPoolParallelBackend : public cv::parallel::ParallelForAPI {
+public:
+    explicit ThreadPoolParallelBackend(ThreadPool& pool);
+
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t body, void* data) override;
+    int getThreadNum() const override;
+    int getNumThreads() const override;
+    // cv::setNumThreads() lands here: the threads one loop may use, the calling one
+    // included. The pool itself keeps its size.
+    int setNumThreads(int threadCount) override;
+    const char* getName() const override { return "node-editor thread pool"; }
+
+    // Makes 'pool' OpenCV's parallel backend, or restores OpenCV's own with nullptr.
+    // The pool must outlive its installation.
+    static void Install(ThreadPool* pool);
+
+private:
+    ThreadPool& m_Pool;
+    std::atomic<int> m_ThreadCount;
+};
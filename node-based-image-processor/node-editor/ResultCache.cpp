@@ -0,0 +1,95 @@
+#include "ResultCache.h"
+
+ResultCache::ResultCache(size_t capacityBytes)
+    : m_Capacity(capacityBytes)
+{
+}
+
+std::shared_ptr<const NodeResults> ResultCache::Find(size_t key)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_Index.find(key);
+    if (it == m_Index.end())
+        return nullptr;
+
+    m_Entries.splice(m_Entries.begin(), m_Entries, it->second);
+    return it->second->Results;
+}
+
+bool ResultCache::Contains(size_t key) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Index.count(key) != 0;
+}
+
+void ResultCache::Insert(size_t key, std::shared_ptr<const NodeResults> results)
+{
+    const size_t bytes = results->GetSizeInBytes();
+
+    // Evicted results are released after the lock is dropped
+    std::list<Entry> evicted;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_Index.find(key);
+    if (it != m_Index.end())
+    {
+        m_Size -= it->second->Bytes;
+        evicted.splice(evicted.begin(), m_Entries, it->second);
+        m_Index.erase(it);
+    }
+
+    // Results larger than the whole cache would only flush it
+    if (bytes > m_Capacity)
+        return;
+
+    m_Entries.push_front({ key, std::move(results), bytes });
+    m_Index[key] = m_Entries.begin();
+    m_Size += bytes;
+    Trim(evicted);
+}
+
+void ResultCache::Clear()
+{
+    std::list<Entry> evicted;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    evicted.swap(m_Entries);
+    m_Index.clear();
+    m_Size = 0;
+}
+
+void ResultCache::SetCapacity(size_t capacityBytes)
+{
+    std::list<Entry> evicted;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Capacity = capacityBytes;
+    Trim(evicted);
+}
+
+size_t ResultCache::GetCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Capacity;
+}
+
+size_t ResultCache::GetSizeInBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Size;
+}
+
+size_t ResultCache::GetEntryCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.size();
+}
+
+void ResultCache::Trim(std::list<Entry>& evicted)
+{
+    while (m_Size > m_Capacity && !m_Entries.empty())
+    {
+        m_Size -= m_Entries.back().Bytes;
+        m_Index.erase(m_Entries.back().Key);
+        evicted.splice(evicted.begin(), m_Entries, std::prev(m_Entries.end()));
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Node.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Bounded in-memory cache of node results, evicting the least recently used first.
+//
+// Results are keyed by how they were computed rather than by their pixels: the node
+// type, its parameters and the keys of its inputs, down to the content of the source
+// images (see NodeEditorManager::ComputeCacheKeys). Going back to a parameter set that
+// was computed before finds its results without running the node again.
+//
+// All methods are thread-safe; nodes fill the cache from the evaluation threads.
+class ResultCache {
+public:
+    explicit ResultCache(size_t capacityBytes);
+
+    // The results stored under 'key', or null. Marks them as recently used.
+    std::shared_ptr<const NodeResults> Find(size_t key);
+    // Like Find() != null, without marking anything as used
+    bool Contains(size_t key) const;
+    void Insert(size_t key, std::shared_ptr<const NodeResults> results);
+    void Clear();
+
+    void SetCapacity(size_t capacityBytes);
+    size_t GetCapacity() const;
+    size_t GetSizeInBytes() const;
+    size_t GetEntryCount() const;
+
+private:
+    struct Entry {
+        size_t Key;
+        std::shared_ptr<const NodeResults> Results;
+        size_t Bytes;
+    };
+
+    // Moves least recently used entries to 'evicted' until the cache fits its capacity.
+    // Requires m_Mutex; the caller releases them once it dropped the lock.
+    void Trim(std::list<Entry>& evicted);
+
+    mutable std::mutex m_Mutex;
+    std::list<Entry> m_Entries; // Most recently used first
+    std::unordered_map<size_t, std::list<Entry>::iterator> m_Index;
+    size_t m_Capacity;
+    size_t m_Size = 0;
+};
@@ -0,0 +1,152 @@
+#include "ThreadPool.h"
+
+namespace {
+    // Identifies the pool and queue owned by the current thread, if it is a worker
+    thread_local ThreadPool* t_Pool = nullptr;
+    thread_local unsigned t_QueueIndex = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = GetHardwareThreadCount();
+
+    for (unsigned i = 0; i < threadCount; i++)
+        m_Queues.push_back(std::make_unique<WorkerQueue>());
+
+    for (unsigned i = 0; i < threadCount; i++)
+        m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for (auto& worker : m_Workers)
+        worker.join();
+}
+
+unsigned ThreadPool::GetHardwareThreadCount()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 1;
+}
+
+int ThreadPool::GetCurrentWorkerIndex() const
+{
+    return (t_Pool == this) ? (int)t_QueueIndex : -1;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    // Workers keep their own follow-up work local, other threads spread it out
+    unsigned queueIndex = (t_Pool == this)
+        ? t_QueueIndex
+        : m_NextQueue.fetch_add(1, std::memory_order_relaxed) % (unsigned)m_Queues.size();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Queues[queueIndex]->Mutex);
+        m_Queues[queueIndex]->Tasks.push_back(std::move(task));
+    }
+    m_QueuedTasks.fetch_add(1);
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+    }
+    m_WakeCondition.notify_one();
+}
+
+bool ThreadPool::TryPopTask(unsigned preferredQueue, std::function<void()>& task)
+{
+    const unsigned queueCount = (unsigned)m_Queues.size();
+
+    // Own queue first, newest task (LIFO)
+    if (preferredQueue < queueCount)
+    {
+        WorkerQueue& own = *m_Queues[preferredQueue];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if (!own.Tasks.empty())
+        {
+            task = std::move(own.Tasks.back());
+            own.Tasks.pop_back();
+            m_QueuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Steal the oldest task from someone else (FIFO)
+    for (unsigned offset = 1; offset <= queueCount; offset++)
+    {
+        unsigned victim = (preferredQueue + offset) % queueCount;
+        if (victim == preferredQueue)
+            continue;
+
+        WorkerQueue& queue = *m_Queues[victim];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if (!queue.Tasks.empty())
+        {
+            task = std::move(queue.Tasks.front());
+            queue.Tasks.pop_front();
+            m_QueuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::RunTask(std::function<void()>& task)
+{
+    task();
+    task = nullptr;
+
+    // Wake threads blocked in RunUntil so they can re-check their condition
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+    }
+    m_TaskDoneCondition.notify_all();
+}
+
+void ThreadPool::WorkerLoop(unsigned index)
+{
+    t_Pool = this;
+    t_QueueIndex = index;
+
+    std::function<void()> task;
+    while (true)
+    {
+        if (TryPopTask(index, task))
+        {
+            RunTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_WakeCondition.wait(lock, [this] { return m_Stopping || m_QueuedTasks.load() > 0; });
+        if (m_Stopping)
+            return;
+    }
+}
+
+void ThreadPool::RunUntil(const std::function<bool()>& done)
+{
+    // Workers help from their own queue, other threads start stealing at queue 0
+    unsigned preferredQueue = (t_Pool == this) ? t_QueueIndex : (unsigned)m_Queues.size();
+
+    std::function<void()> task;
+    while (!done())
+    {
+        if (TryPopTask(preferredQueue, task))
+        {
+            RunTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_TaskDoneCondition.wait(lock, [&] { return m_QueuedTasks.load() > 0 || done(); });
+    }
+}
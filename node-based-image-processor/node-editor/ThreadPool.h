@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool used to evaluate independent nodes concurrently.
+//
+// Every worker owns a task deque. Tasks submitted from a worker go to the back
+// of that worker's own deque and are popped LIFO, which keeps a chain of nodes
+// on the core whose cache already holds its input. Idle workers steal from the
+// front of other workers' deques. Tasks submitted from outside the pool are
+// distributed round-robin.
+class ThreadPool {
+public:
+    // threadCount == 0 sizes the pool to the machine
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // Run queued tasks on the calling thread until 'done' returns true.
+    // 'done' must become true as a side effect of tasks run by this pool.
+    void RunUntil(const std::function<bool()>& done);
+
+    unsigned GetThreadCount() const { return (unsigned)m_Workers.size(); }
+    // Index of the calling thread among the workers, -1 if it is not one of them
+    int GetCurrentWorkerIndex() const;
+
+    // Number of hardware threads, never less than one
+    static unsigned GetHardwareThreadCount();
+
+private:
+    struct WorkerQueue {
+        std::mutex Mutex;
+        std::deque<std::function<void()>> Tasks;
+    };
+
+    void WorkerLoop(unsigned index);
+    bool TryPopTask(unsigned preferredQueue, std::function<void()>& task);
+    void RunTask(std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_Queues;
+    std::vector<std::thread> m_Workers;
+
+    // Sleeping/waking of idle workers and of threads waiting in RunUntil
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_TaskDoneCondition;
+    std::atomic<int> m_QueuedTasks{ 0 };
+    std::atomic<unsigned> m_NextQueue{ 0 };
+    bool m_Stopping = false;
+};
@@ -13,7 +13,7 @@ BlendNode::BlendNode(int id)
     AddOutputPin("Result", PinType::Image);
 }
 
-void BlendNode::Process()
+void BlendNode::Process(const EvaluationContext& context)
 {
     // Get input images from the ImageDataManager
     if (Inputs.size() >= 2)
@@ -32,10 +32,12 @@ void BlendNode::Process()
     {
         // If either input is missing, clear output
         m_OutputImage = cv::Mat();
-        CleanupTexture();
         return;
     }
     
+    if (context.IsCancelled())
+        return;
+    
     // Make sure both images have the same size - resize the second image if needed
     cv::Mat resizedImage2;
     if (m_InputImage1.size() != m_InputImage2.size())
@@ -44,36 +46,25 @@ void BlendNode::Process()
     }
     else
     {
-        resizedImage2 = m_InputImage2.clone();
+        // Share the input; the conversions below always write to a new buffer
+        resizedImage2 = m_InputImage2;
     }
     
     // Make sure both images have the same type
-    if (m_InputImage1.type() != resizedImage2.type())
-    {
-        // Convert the second image to match the type of the first
-        if (m_InputImage1.channels() == 3 && resizedImage2.channels() == 4)
-        {
-            cv::cvtColor(resizedImage2, resizedImage2, cv::COLOR_BGRA2BGR);
-        }
-        else if (m_InputImage1.channels() == 4 && resizedImage2.channels() == 3)
-        {
-            cv::cvtColor(resizedImage2, resizedImage2, cv::COLOR_BGR2BGRA);
-        }
-        else if (m_InputImage1.channels() == 1 && resizedImage2.channels() > 1)
-        {
-            cv::cvtColor(resizedImage2, resizedImage2, cv::COLOR_BGR2GRAY);
-        }
-        else if (m_InputImage1.channels() > 1 && resizedImage2.channels() == 1)
-        {
-            cv::cvtColor(resizedImage2, resizedImage2, cv::COLOR_GRAY2BGR);
-        }
-    }
-    
-    // Apply blending
-    m_OutputImage = ApplyBlend(m_InputImage1, resizedImage2);
+    resizedImage2 = MatchChannels(resizedImage2, m_InputImage1);
     
-    // Update the preview texture
-    UpdatePreviewTexture();
+    // Apply blending band by band; every blend mode is pointwise
+    cv::Mat result;
+    bool completed = context.ForEachRowBand(m_InputImage1.rows, [&](const cv::Range& rows)
+    {
+        cv::Mat blendedBand = ApplyBlend(m_InputImage1.rowRange(rows), resizedImage2.rowRange(rows));
+        if (result.empty())
+            result.create(m_InputImage1.size(), blendedBand.type());
+        blendedBand.copyTo(result.rowRange(rows));
+    });
+    if (!completed)
+        return;
+    m_OutputImage = result;
     
     // Set the output data in ImageDataManager
     if (!Outputs.empty())
@@ -82,12 +73,79 @@ void BlendNode::Process()
     }
 }
 
-cv::Mat BlendNode::ApplyBlend(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::MatchChannels(const cv::Mat& blendImg, const cv::Mat& baseImg)
+{
+    if (baseImg.type() == blendImg.type())
+        return blendImg;
+
+    // Convert the blend image to match the type of the base image
+    cv::Mat converted = blendImg;
+    if (baseImg.channels() == 3 && blendImg.channels() == 4)
+    {
+        cv::cvtColor(blendImg, converted, cv::COLOR_BGRA2BGR);
+    }
+    else if (baseImg.channels() == 4 && blendImg.channels() == 3)
+    {
+        cv::cvtColor(blendImg, converted, cv::COLOR_BGR2BGRA);
+    }
+    else if (baseImg.channels() == 1 && blendImg.channels() > 1)
+    {
+        cv::cvtColor(blendImg, converted, cv::COLOR_BGR2GRAY);
+    }
+    else if (baseImg.channels() > 1 && blendImg.channels() == 1)
+    {
+        cv::cvtColor(blendImg, converted, cv::COLOR_GRAY2BGR);
+    }
+    return converted;
+}
+
+int BlendNode::GetInputHalo() const
+{
+    // Every blend mode is pointwise
+    return 0;
+}
+
+bool BlendNode::GetParameterHash(size_t& hash) const
+{
+    hash = 0;
+    HashCombine(hash, (int)m_ProcessParams.Mode);
+    HashCombine(hash, m_ProcessParams.Opacity);
+    return true;
+}
+
+void BlendNode::ProcessSideTile(const cv::Mat& input, const std::vector<cv::Mat>& sideInputs, cv::Mat& output) const
+{
+    // The engine only tiles a blend whose inputs have the same size, so the blend tile
+    // lines up with the base tile and only needs its channels converted
+    if (sideInputs.empty() || sideInputs[0].empty())
+        return;
+
+    output = ApplyBlend(input, MatchChannels(sideInputs[0], input));
+}
+
+void BlendNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void BlendNode::UpdatePreview()
+{
+    // Re-create the preview from the latest output (or drop it if there is none)
+    UpdatePreviewTexture();
+}
+
+void BlendNode::ReleaseInputs()
+{
+    m_InputImage1.release();
+    m_InputImage2.release();
+}
+
+cv::Mat BlendNode::ApplyBlend(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
     cv::Mat blendedResult;
     
     // Apply the selected blend mode
-    switch (m_BlendMode)
+    switch (m_ProcessParams.Mode)
     {
         case BlendMode::Normal:
             blendedResult = BlendNormal(baseImg, blendImg);
@@ -111,11 +169,11 @@ cv::Mat BlendNode::ApplyBlend(const cv::Mat& baseImg, const cv::Mat& blendImg)
             blendedResult = BlendDarken(baseImg, blendImg);
             break;
         default:
-            blendedResult = baseImg.clone();
+            blendedResult = baseImg;
     }
     
     // Apply opacity if not 100%
-    if (m_Opacity < 1.0f)
+    if (m_ProcessParams.Opacity < 1.0f)
     {
         blendedResult = ApplyOpacity(baseImg, blendedResult);
     }
@@ -123,13 +181,13 @@ cv::Mat BlendNode::ApplyBlend(const cv::Mat& baseImg, const cv::Mat& blendImg)
     return blendedResult;
 }
 
-cv::Mat BlendNode::BlendNormal(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendNormal(const cv::Mat& /*baseImg*/, const cv::Mat& blendImg) const
 {
-    // Normal blend simply returns the blend image
-    return blendImg.clone();
+    // Normal blend simply returns the blend image (shared, images are immutable)
+    return blendImg;
 }
 
-cv::Mat BlendNode::BlendMultiply(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendMultiply(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
     cv::Mat result;
     // Multiply blend: multiply pixel values and normalize
@@ -137,9 +195,9 @@ cv::Mat BlendNode::BlendMultiply(const cv::Mat& baseImg, const cv::Mat& blendImg
     return result;
 }
 
-cv::Mat BlendNode::BlendScreen(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendScreen(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
-    cv::Mat result = baseImg.clone();
+    cv::Mat result;
     
     // Screen blend: 1 - (1 - Base) * (1 - Blend)
     cv::Mat invBase, invBlend, temp;
@@ -151,9 +209,10 @@ cv::Mat BlendNode::BlendScreen(const cv::Mat& baseImg, const cv::Mat& blendImg)
     return result;
 }
 
-cv::Mat BlendNode::BlendOverlay(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendOverlay(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
-    cv::Mat result = baseImg.clone();
+    // Every pixel is written below, so only allocate (no need to copy the base image)
+    cv::Mat result(baseImg.size(), baseImg.type());
     
     // Overlay blend: if Base < 128, 2 * Base * Blend / 255, else 255 - 2 * (255 - Base) * (255 - Blend) / 255
     
@@ -207,7 +266,7 @@ cv::Mat BlendNode::BlendOverlay(const cv::Mat& baseImg, const cv::Mat& blendImg)
     return result;
 }
 
-cv::Mat BlendNode::BlendDifference(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendDifference(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
     cv::Mat result;
     // Difference blend: |Base - Blend|
@@ -215,7 +274,7 @@ cv::Mat BlendNode::BlendDifference(const cv::Mat& baseImg, const cv::Mat& blendI
     return result;
 }
 
-cv::Mat BlendNode::BlendLighten(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendLighten(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
     cv::Mat result;
     // Lighten blend: max(Base, Blend)
@@ -223,7 +282,7 @@ cv::Mat BlendNode::BlendLighten(const cv::Mat& baseImg, const cv::Mat& blendImg)
     return result;
 }
 
-cv::Mat BlendNode::BlendDarken(const cv::Mat& baseImg, const cv::Mat& blendImg)
+cv::Mat BlendNode::BlendDarken(const cv::Mat& baseImg, const cv::Mat& blendImg) const
 {
     cv::Mat result;
     // Darken blend: min(Base, Blend)
@@ -231,11 +290,11 @@ cv::Mat BlendNode::BlendDarken(const cv::Mat& baseImg, const cv::Mat& blendImg)
     return result;
 }
 
-cv::Mat BlendNode::ApplyOpacity(const cv::Mat& baseImg, const cv::Mat& blendedImg)
+cv::Mat BlendNode::ApplyOpacity(const cv::Mat& baseImg, const cv::Mat& blendedImg) const
 {
     // Apply opacity (blend between base image and blended result)
     cv::Mat result;
-    cv::addWeighted(baseImg, 1.0f - m_Opacity, blendedImg, m_Opacity, 0.0, result);
+    cv::addWeighted(baseImg, 1.0f - m_ProcessParams.Opacity, blendedImg, m_ProcessParams.Opacity, 0.0, result);
     return result;
 }
 
@@ -248,7 +307,7 @@ void BlendNode::DrawNodeContent()
 
     // Blend Mode combo box
     const char* blendModes[] = { "Normal", "Multiply", "Screen", "Overlay", "Difference", "Lighten", "Darken" };
-    int currentMode = static_cast<int>(m_BlendMode);
+    int currentMode = static_cast<int>(m_Params.Mode);
     const float itemWidth = 150.0f; // Define a width for the widgets
 
     ImGui::Text("Blend Mode:");
@@ -257,40 +316,40 @@ void BlendNode::DrawNodeContent()
     ImGui::PopItemWidth();
     if (changed)
     {
-        m_BlendMode = static_cast<BlendMode>(currentMode);
+        m_Params.Mode = static_cast<BlendMode>(currentMode);
     }
 
     // Opacity slider
     ImGui::Text("Opacity:");
     ImGui::PushItemWidth(itemWidth);
-    changed |= ImGui::SliderFloat("##Opacity", &m_Opacity, 0.0f, 1.0f, "%.2f");
+    changed |= ImGui::SliderFloat("##Opacity", &m_Params.Opacity, 0.0f, 1.0f, "%.2f");
     ImGui::PopItemWidth();
     ImGui::SameLine();
     if (ImGui::Button("Reset"))
     {
-        m_Opacity = 1.0f;
+        m_Params.Opacity = 1.0f;
         changed = true;
     }
 
     // Mark node as dirty if any parameter changed
     if (changed)
     {
-        Dirty = true;
+        SetDirty(true);
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    if (m_ShowPreview && !m_OutputImage.empty() && m_PreviewTexture)
+    if (m_ShowPreview && !m_DisplayImage.empty() && m_PreviewTexture)
     {
         ImGui::Separator(); // Add separator before preview
         // Calculate preview size
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
 
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
 
         if (previewHeight > maxPreviewHeight)
@@ -315,29 +374,14 @@ void BlendNode::UpdatePreviewTexture()
     // Clean up any existing texture
     CleanupTexture();
 
-    // Use the local output image
-    if (m_OutputImage.empty())
-        return;
-
-    // Verify we have valid image data
-    if (m_OutputImage.data == nullptr)
+    // The RGBA preview was already prepared on the evaluation thread
+    if (m_PreviewImage.empty())
         return;
 
-    // Convert image from OpenCV BGR format to RGB for OpenGL
-    cv::Mat rgbImage;
-    if (m_OutputImage.channels() == 3)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGR2RGBA);
-    else if (m_OutputImage.channels() == 4)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGRA2RGBA);
-    else if (m_OutputImage.channels() == 1)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_GRAY2RGBA);
-    else
-        rgbImage = m_OutputImage.clone(); // Just use as-is if format is unexpected
-
     // Use ImageEditorApp singleton to create texture
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbImage.data, rgbImage.cols, rgbImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
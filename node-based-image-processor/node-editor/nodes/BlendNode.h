@@ -19,35 +19,47 @@ public:
     ~BlendNode() override = default;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void UpdatePreview() override;
+    void ReleaseInputs() override;
+    int GetInputHalo() const override;
+    bool GetParameterHash(size_t& hash) const override;
+    void ProcessSideTile(const cv::Mat& input, const std::vector<cv::Mat>& sideInputs, cv::Mat& output) const override;
 
 private:
     // Blend parameters
-    BlendMode m_BlendMode = BlendMode::Normal;
-    float m_Opacity = 1.0f;  // Range: 0 to 1
+    struct Parameters {
+        BlendMode Mode = BlendMode::Normal;
+        float Opacity = 1.0f;  // Range: 0 to 1
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
     
     // Input/Output images
     cv::Mat m_InputImage1;   // Base image
     cv::Mat m_InputImage2;   // Blend image
     // m_OutputImage is inherited from Node base class
     ImTextureID m_PreviewTexture = nullptr;
-    bool m_ShowPreview = true; // Added for optional preview
 
     // Helper methods
     void UpdatePreviewTexture();
     void CleanupTexture();
     
+    // Converts the blend image to the channel layout of the base image
+    static cv::Mat MatchChannels(const cv::Mat& blendImg, const cv::Mat& baseImg);
+
     // Blend operations
-    cv::Mat ApplyBlend(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendNormal(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendMultiply(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendScreen(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendOverlay(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendDifference(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendLighten(const cv::Mat& baseImg, const cv::Mat& blendImg);
-    cv::Mat BlendDarken(const cv::Mat& baseImg, const cv::Mat& blendImg);
+    cv::Mat ApplyBlend(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendNormal(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendMultiply(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendScreen(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendOverlay(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendDifference(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendLighten(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
+    cv::Mat BlendDarken(const cv::Mat& baseImg, const cv::Mat& blendImg) const;
     
     // Apply opacity/alpha to the blended result
-    cv::Mat ApplyOpacity(const cv::Mat& baseImg, const cv::Mat& blendedImg);
+    cv::Mat ApplyOpacity(const cv::Mat& baseImg, const cv::Mat& blendedImg) const;
 };
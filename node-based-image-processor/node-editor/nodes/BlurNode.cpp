@@ -3,6 +3,7 @@
 #include "../../ImageEditorApp.h"  // Added this include to access the app instance
 #include <imgui.h>
 #include <opencv2/imgproc.hpp>
+#include <algorithm>
 
 // ... existing code ...
 
@@ -14,10 +15,10 @@ BlurNode::BlurNode(int id)
     AddOutputPin("Image", PinType::Image);
     
     // Initialize kernel
-    GenerateKernel();
+    m_Params.Kernel = GenerateKernel(m_Params);
 }
 
-void BlurNode::Process()
+void BlurNode::Process(const EvaluationContext& context)
 {
     // Get input image from the ImageDataManager
     if (!Inputs.empty())
@@ -32,26 +33,46 @@ void BlurNode::Process()
     if (m_InputImage.empty())
     {
         m_OutputImage = cv::Mat();
-        CleanupTexture();
         return;
     }
     
-    // Generate the kernel based on current parameters
-    GenerateKernel();
-    
     // Apply the blur effect to the input image
-    m_OutputImage = ApplyBlur(m_InputImage);
+    cv::Mat result = ApplyBlur(m_InputImage, context);
+    if (result.empty())
+        return; // Cancelled
+    m_OutputImage = result;
     
     // Set the output image in the ImageDataManager
     if (!m_OutputImage.empty() && !Outputs.empty())
     {
         ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
     }
-    
-    // Update the preview texture
+}
+
+void BlurNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void BlurNode::ScaleParameters(double scale)
+{
+    // The radius is in pixels; the directional spread is a squared distance
+    m_ProcessParams.BlurRadius = std::max(1, cvRound(m_Params.BlurRadius * scale));
+    m_ProcessParams.DirectionalFactor = std::max(0.01f, (float)(m_Params.DirectionalFactor * scale * scale));
+    m_ProcessParams.Kernel = GenerateKernel(m_ProcessParams);
+}
+
+void BlurNode::UpdatePreview()
+{
+    // Re-create the preview from the latest output (or drop it if there is none)
     UpdatePreviewTexture();
 }
 
+void BlurNode::ReleaseInputs()
+{
+    m_InputImage.release();
+}
+
 void BlurNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
@@ -62,37 +83,39 @@ void BlurNode::DrawNodeContent()
 
     // Blur radius slider
     ImGui::PushItemWidth(itemWidth);
-    changed |= ImGui::SliderInt("Radius", &m_BlurRadius, 1, 20);
+    changed |= ImGui::SliderInt("Radius", &m_Params.BlurRadius, 1, 20);
     ImGui::PopItemWidth();
 
     // Directional blur checkbox
-    changed |= ImGui::Checkbox("Directional Blur", &m_DirectionalBlur);
+    changed |= ImGui::Checkbox("Directional Blur", &m_Params.DirectionalBlur);
     
     // Additional parameters for directional blur
-    if (m_DirectionalBlur)
+    if (m_Params.DirectionalBlur)
     {
         ImGui::PushItemWidth(itemWidth);
-        changed |= ImGui::SliderFloat("Angle", &m_DirectionalAngle, 0.0f, 360.0f, "%.1f°");
-        changed |= ImGui::SliderFloat("Strength", &m_DirectionalFactor, 1.0f, 10.0f, "%.1f");
+        changed |= ImGui::SliderFloat("Angle", &m_Params.DirectionalAngle, 0.0f, 360.0f, "%.1f°");
+        changed |= ImGui::SliderFloat("Strength", &m_Params.DirectionalFactor, 1.0f, 10.0f, "%.1f");
         ImGui::PopItemWidth();
     }
 
-    // Mark node as dirty if any parameter changed
+    // Rebuild the kernel and mark node as dirty if any parameter changed
     if (changed)
     {
-        Dirty = true;
+        m_Params.Kernel = GenerateKernel(m_Params);
+        SetDirty(true);
     }
     
     ImGui::Separator();
     
     // Kernel visualization
-    if (!m_Kernel.empty())
+    const cv::Mat& kernel = m_Params.Kernel;
+    if (!kernel.empty())
     {
         ImGui::Text("Kernel:");
         
         // Determine the size to display the kernel
         const float cellSize = 20.0f;
-        int kernelSize = m_Kernel.rows;
+        int kernelSize = kernel.rows;
         
         // Draw the kernel as a grid of values
         ImDrawList* drawList = ImGui::GetWindowDrawList();
@@ -110,7 +133,7 @@ void BlurNode::DrawNodeContent()
                 ImVec2 cellPos(startPos.x + x * cellSize, startPos.y + y * cellSize);
                 
                 // Get kernel value at this position
-                float value = m_Kernel.at<float>(y, x);
+                float value = kernel.at<float>(y, x);
                 
                 // Scale the value for visualization (kernel values are usually small)
                 value = value * 255 * 5; // Scaling for better visibility
@@ -138,10 +161,10 @@ void BlurNode::DrawNodeContent()
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    // Note: m_OutputImage is a local variable in Process(), but we check m_PreviewTexture which is updated based on it.
+    // Note: m_PreviewTexture and m_DisplayImage both come from the last completed evaluation
     if (m_ShowPreview && m_PreviewTexture) // Check if texture exists (implies output was generated)
     {
         ImGui::Separator();
@@ -151,8 +174,8 @@ void BlurNode::DrawNodeContent()
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
         
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
         
         if (previewHeight > maxPreviewHeight)
@@ -172,21 +195,23 @@ void BlurNode::DrawNodeContent()
 	ImGui::PopID(); // Pop ID for this node instance
 }
 
-void BlurNode::GenerateKernel()
+cv::Mat BlurNode::GenerateKernel(const Parameters& params)
 {
     // Calculate kernel size based on blur radius (must be odd)
-    int kernelSize = m_BlurRadius * 2 + 1;
+    int kernelSize = params.BlurRadius * 2 + 1;
     
-    if (m_DirectionalBlur)
+    // Always build a new Mat - the previous kernel may still be in use by Process()
+    cv::Mat kernel;
+    if (params.DirectionalBlur)
     {
         // Create directional blur kernel
-        m_Kernel = cv::Mat::zeros(kernelSize, kernelSize, CV_32F);
+        kernel = cv::Mat::zeros(kernelSize, kernelSize, CV_32F);
         
         // Center of kernel
         int center = kernelSize / 2;
         
         // Convert angle to radians
-        float angleRad = m_DirectionalAngle * CV_PI / 180.0f;
+        float angleRad = params.DirectionalAngle * CV_PI / 180.0f;
         
         // Direction vector
         float dirX = std::cos(angleRad);
@@ -207,13 +232,13 @@ void BlurNode::GenerateKernel()
                 float distance = std::abs(dirX * dy - dirY * dx);
                 
                 // Gaussian-like value based on distance
-                float value = std::exp(-(distance * distance) / (2.0f * m_DirectionalFactor));
+                float value = std::exp(-(distance * distance) / (2.0f * params.DirectionalFactor));
                 
                 // Linear distance from center also affects the value
                 float centerDistance = std::sqrt(dx * dx + dy * dy);
-                value *= std::exp(-(centerDistance * centerDistance) / (2.0f * m_BlurRadius * m_BlurRadius));
+                value *= std::exp(-(centerDistance * centerDistance) / (2.0f * params.BlurRadius * params.BlurRadius));
                 
-                m_Kernel.at<float>(y, x) = value;
+                kernel.at<float>(y, x) = value;
                 sum += value;
             }
         }
@@ -221,27 +246,59 @@ void BlurNode::GenerateKernel()
         // Normalize the kernel so the sum equals 1
         if (sum > 0)
         {
-            m_Kernel /= sum;
+            kernel /= sum;
         }
     }
     else
     {
         // Create standard Gaussian blur kernel
-        m_Kernel = cv::getGaussianKernel(kernelSize, m_BlurRadius);
+        kernel = cv::getGaussianKernel(kernelSize, params.BlurRadius);
         
         // Convert 1D kernel to 2D
-        m_Kernel = m_Kernel * m_Kernel.t();
+        kernel = kernel * kernel.t();
     }
+
+    return kernel;
 }
 
-cv::Mat BlurNode::ApplyBlur(const cv::Mat& inputImage)
+int BlurNode::GetInputHalo() const
 {
-    cv::Mat result;
+    return std::max(m_ProcessParams.Kernel.rows, m_ProcessParams.Kernel.cols) / 2;
+}
+
+bool BlurNode::GetParameterHash(size_t& hash) const
+{
+    // The kernel is built from the other values. A plain blur ignores the directional
+    // settings, so blurs differing only in those still merge and share cache entries.
+    hash = 0;
+    HashCombine(hash, m_ProcessParams.BlurRadius);
+    HashCombine(hash, m_ProcessParams.DirectionalBlur);
+    if (m_ProcessParams.DirectionalBlur)
+    {
+        HashCombine(hash, m_ProcessParams.DirectionalAngle);
+        HashCombine(hash, m_ProcessParams.DirectionalFactor);
+    }
+    return true;
+}
+
+void BlurNode::ProcessTile(const cv::Mat& input, cv::Mat& output) const
+{
+    // filter2D reads the pixels around a submatrix from its parent image
+    cv::filter2D(input, output, -1, m_ProcessParams.Kernel);
+}
+
+cv::Mat BlurNode::ApplyBlur(const cv::Mat& inputImage, const EvaluationContext& context)
+{
+    cv::Mat result(inputImage.size(), inputImage.type());
     
-    // Apply the kernel to the input image
-    cv::filter2D(inputImage, result, -1, m_Kernel);
+    // Apply the kernel to the input image, band by band so a newer radius can cancel it
+    bool completed = context.ForEachRowBand(inputImage.rows, [&](const cv::Range& rows)
+    {
+        cv::Mat resultBand = result.rowRange(rows);
+        ProcessTile(inputImage.rowRange(rows), resultBand);
+    });
     
-    return result;
+    return completed ? result : cv::Mat();
 }
 
 void BlurNode::UpdatePreviewTexture()
@@ -249,29 +306,14 @@ void BlurNode::UpdatePreviewTexture()
     // Clean up any existing texture
     CleanupTexture();
     
-    // Use the local output image
-    if (m_OutputImage.empty())
-        return;
-    
-    // Verify we have valid image data
-    if (m_OutputImage.data == nullptr)
+    // The RGBA preview was already prepared on the evaluation thread
+    if (m_PreviewImage.empty())
         return;
 
-    // Convert image from OpenCV BGR format to RGB for OpenGL
-    cv::Mat rgbImage;
-    if (m_OutputImage.channels() == 3)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGR2RGBA);
-    else if (m_OutputImage.channels() == 4)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGRA2RGBA);
-    else if (m_OutputImage.channels() == 1)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_GRAY2RGBA);
-    else
-        rgbImage = m_OutputImage.clone(); // Just use as-is if format is unexpected
-    
     // Use ImageEditorApp singleton to create texture instead of direct OpenGL calls
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbImage.data, rgbImage.cols, rgbImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
@@ -8,27 +8,35 @@ public:
     ~BlurNode() override = default;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void ScaleParameters(double scale) override;
+    int GetInputHalo() const override;
+    bool GetParameterHash(size_t& hash) const override;
+    void ProcessTile(const cv::Mat& input, cv::Mat& output) const override;
+    void UpdatePreview() override;
+    void ReleaseInputs() override;
 
 private:
     // Input/Output images
     cv::Mat m_InputImage;
     ImTextureID m_PreviewTexture = nullptr;
-    bool m_ShowPreview = true; // Added for optional preview
 
     // Blur parameters
-    int m_BlurRadius = 5;        // Range: 1-20
-    bool m_DirectionalBlur = false;
-    float m_DirectionalAngle = 0.0f;  // In degrees, 0-360
-    float m_DirectionalFactor = 5.0f; // How strong the directional effect is
-    
-    // Kernel visualization
-    cv::Mat m_Kernel;
+    struct Parameters {
+        int BlurRadius = 5;        // Range: 1-20
+        bool DirectionalBlur = false;
+        float DirectionalAngle = 0.0f;  // In degrees, 0-360
+        float DirectionalFactor = 5.0f; // How strong the directional effect is
+        cv::Mat Kernel;                 // Built from the values above by GenerateKernel()
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
     
     // Helper methods
     void UpdatePreviewTexture();
     void CleanupTexture();
-    void GenerateKernel();
-    cv::Mat ApplyBlur(const cv::Mat& inputImage);
+    static cv::Mat GenerateKernel(const Parameters& params);
+    cv::Mat ApplyBlur(const cv::Mat& inputImage, const EvaluationContext& context); // Empty if cancelled
 };
@@ -13,7 +13,7 @@ BrightnessContrastNode::BrightnessContrastNode(int id)
     AddOutputPin("Image", PinType::Image);
 }
 
-void BrightnessContrastNode::Process()
+void BrightnessContrastNode::Process(const EvaluationContext& context)
 {
     // Get input image from the ImageDataManager
     if (!Inputs.empty())
@@ -29,30 +29,68 @@ void BrightnessContrastNode::Process()
     {
         // No input image, clear output
         m_OutputImage = cv::Mat();
-        CleanupTexture();
         return;
     }
     
-    // Apply brightness and contrast adjustments
-    m_OutputImage = cv::Mat::zeros(m_InputImage.size(), m_InputImage.type());
-    
-    // Calculate alpha (contrast) and beta (brightness) for linear transformation
-    double alpha = m_Contrast; // Contrast control (1.0 - 3.0)
-    int beta = (int)m_Brightness; // Brightness control (-100 -> +100)
-    
-    // Apply the transformation: new_pixel = alpha * pixel + beta
-    m_InputImage.convertTo(m_OutputImage, -1, alpha, beta);
+    // Write into a fresh buffer - the previous output may still be shared with consumers.
+    // The operation is pointwise, so it runs band by band and stops once cancelled.
+    cv::Mat result(m_InputImage.size(), m_InputImage.type());
+    bool completed = context.ForEachRowBand(m_InputImage.rows, [&](const cv::Range& rows)
+    {
+        cv::Mat resultBand = result.rowRange(rows);
+        ProcessTile(m_InputImage.rowRange(rows), resultBand);
+    });
+    if (!completed)
+        return;
+
+    m_OutputImage = result;
     
     // Set the image data in the ImageDataManager for the output pin
     if (!m_OutputImage.empty() && !Outputs.empty())
     {
         ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
     }
-    
-    // Update the preview texture
+}
+
+void BrightnessContrastNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void BrightnessContrastNode::UpdatePreview()
+{
+    // Re-create the preview from the latest output (or drop it if there is none)
     UpdatePreviewTexture();
 }
 
+void BrightnessContrastNode::ReleaseInputs()
+{
+    m_InputImage.release();
+}
+
+int BrightnessContrastNode::GetInputHalo() const
+{
+    return 0; // Pointwise
+}
+
+bool BrightnessContrastNode::GetParameterHash(size_t& hash) const
+{
+    hash = 0;
+    HashCombine(hash, m_ProcessParams.Brightness);
+    HashCombine(hash, m_ProcessParams.Contrast);
+    return true;
+}
+
+void BrightnessContrastNode::ProcessTile(const cv::Mat& input, cv::Mat& output) const
+{
+    // Calculate alpha (contrast) and beta (brightness) for linear transformation
+    double alpha = m_ProcessParams.Contrast; // Contrast control (1.0 - 3.0)
+    int beta = (int)m_ProcessParams.Brightness; // Brightness control (-100 -> +100)
+    
+    // Apply the transformation: new_pixel = alpha * pixel + beta
+    input.convertTo(output, -1, alpha, beta);
+}
+
 void BrightnessContrastNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
@@ -62,7 +100,7 @@ void BrightnessContrastNode::DrawNodeContent()
 
     ImGui::PushItemWidth(itemWidth); // Push item width before sliders
     // Brightness slider
-    changed |= ImGui::SliderFloat("Brightness", &m_Brightness, -100.0f, 100.0f, "%.1f");
+    changed |= ImGui::SliderFloat("Brightness", &m_Params.Brightness, -100.0f, 100.0f, "%.1f");
     ImGui::PopItemWidth(); // Pop item width after slider
     ImGui::SameLine();
     if (ImGui::Button("Reset##Brightness"))
@@ -73,7 +111,7 @@ void BrightnessContrastNode::DrawNodeContent()
 
     ImGui::PushItemWidth(itemWidth); // Push item width before sliders
     // Contrast slider
-    changed |= ImGui::SliderFloat("Contrast", &m_Contrast, 0.0f, 3.0f, "%.2f");
+    changed |= ImGui::SliderFloat("Contrast", &m_Params.Contrast, 0.0f, 3.0f, "%.2f");
     ImGui::PopItemWidth(); // Pop item width after slider
     ImGui::SameLine();
     if (ImGui::Button("Reset##Contrast"))
@@ -85,22 +123,22 @@ void BrightnessContrastNode::DrawNodeContent()
     // Mark node as dirty if any parameter changed
     if (changed)
     {
-        Dirty = true;
+        SetDirty(true);
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    if (m_ShowPreview && !m_OutputImage.empty() && m_PreviewTexture)
+    if (m_ShowPreview && !m_DisplayImage.empty() && m_PreviewTexture)
     {
         ImGui::Separator(); // Add separator before preview
         // Calculate preview size
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
         
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
         
         if (previewHeight > maxPreviewHeight)
@@ -124,29 +162,14 @@ void BrightnessContrastNode::UpdatePreviewTexture()
     // Clean up any existing texture
     CleanupTexture();
 
-    // Use the local output image
-    if (m_OutputImage.empty())
+    // The RGBA preview was already prepared on the evaluation thread
+    if (m_PreviewImage.empty())
         return;
 
-    // Verify we have valid image data
-    if (m_OutputImage.data == nullptr)
-        return;
-
-    // Convert image from OpenCV BGR format to RGB for OpenGL
-    cv::Mat rgbImage;
-    if (m_OutputImage.channels() == 3)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGR2RGBA);
-    else if (m_OutputImage.channels() == 4)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGRA2RGBA);
-    else if (m_OutputImage.channels() == 1)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_GRAY2RGBA);
-    else
-        rgbImage = m_OutputImage.clone(); // Just use as-is if format is unexpected
-
     // Use ImageEditorApp singleton to create texture instead of direct OpenGL calls
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbImage.data, rgbImage.cols, rgbImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
@@ -8,19 +8,28 @@ public:
     ~BrightnessContrastNode() override = default;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    int GetInputHalo() const override;
+    bool GetParameterHash(size_t& hash) const override;
+    void ProcessTile(const cv::Mat& input, cv::Mat& output) const override;
+    void UpdatePreview() override;
+    void ReleaseInputs() override;
 
 private:
     // Parameters
-    float m_Brightness = 0.0f;  // Range: -100 to +100
-    float m_Contrast = 1.0f;    // Range: 0 to 3
+    struct Parameters {
+        float Brightness = 0.0f;  // Range: -100 to +100
+        float Contrast = 1.0f;    // Range: 0 to 3
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
     
     // Input/Output images
     cv::Mat m_InputImage;
     // m_OutputImage is inherited from Node base class
     ImTextureID m_PreviewTexture = nullptr;
-    bool m_ShowPreview = true; // Added for optional preview
 
     // Display helpers
     void UpdatePreviewTexture();
@@ -28,6 +37,6 @@ private:
     cv::Mat GetConnectedImage();
     
     // Reset functionality
-    void ResetBrightness() { m_Brightness = 0.0f; Dirty = true; }
-    void ResetContrast() { m_Contrast = 1.0f; Dirty = true; }
+    void ResetBrightness() { m_Params.Brightness = 0.0f; SetDirty(true); }
+    void ResetContrast() { m_Params.Contrast = 1.0f; SetDirty(true); }
 };
@@ -15,7 +15,7 @@ ColorChannelSplitterNode::ColorChannelSplitterNode(int id)
     AddOutputPin("Alpha", PinType::Image);
 }
 
-void ColorChannelSplitterNode::Process()
+void ColorChannelSplitterNode::Process(const EvaluationContext& context)
 {
     // Get input image from the ImageDataManager
     if (!Inputs.empty())
@@ -34,56 +34,42 @@ void ColorChannelSplitterNode::Process()
         m_GreenChannel = cv::Mat();
         m_BlueChannel = cv::Mat();
         m_AlphaChannel = cv::Mat();
-        CleanupTextures();
         return;
     }
     
-    // Split the image into its color channels
-    std::vector<cv::Mat> channels;
-    cv::split(m_InputImage, channels);
-    
     // Assign channels based on input image type
     int numChannels = m_InputImage.channels();
     
-    // Initialize all channels to empty
-    m_RedChannel = cv::Mat();
-    m_GreenChannel = cv::Mat();
-    m_BlueChannel = cv::Mat();
-    m_AlphaChannel = cv::Mat();
-    
-    // BGR or BGRA image (OpenCV's default format)
-    if (numChannels >= 3)
+    // Only the requested outputs are extracted (and colorized below), the others stay
+    // empty. Output pins are Red, Green, Blue, Alpha; channels are in BGR(A) order.
+    auto extractChannel = [&](int outputIndex, int channel)
     {
-        m_BlueChannel = channels[0];
-        m_GreenChannel = channels[1];
-        m_RedChannel = channels[2];
+        cv::Mat result;
+        if (!IsOutputRequested(outputIndex))
+            return result;
         
-        if (numChannels == 4)
+        if (numChannels >= 3 && channel < numChannels)
         {
-            m_AlphaChannel = channels[3];
+            cv::extractChannel(m_InputImage, result, channel);
         }
-    }
-    else if (numChannels == 1)
-    {
-        // Grayscale image - use the same channel for R, G, B
-        m_RedChannel = channels[0];
-        m_GreenChannel = channels[0];
-        m_BlueChannel = channels[0];
-    }
+        else if (numChannels == 1 && channel < 3)
+        {
+            // Grayscale image - use the same channel for R, G, B (shared, images are immutable)
+            result = m_InputImage;
+        }
+        return result;
+    };
     
-    // If grayscale output is enabled, convert each channel to grayscale
-    if (m_OutputGrayscale)
-    {
-        if (!m_RedChannel.empty())
-            m_RedChannel = m_RedChannel.clone(); // Already grayscale
-        if (!m_GreenChannel.empty())
-            m_GreenChannel = m_GreenChannel.clone(); // Already grayscale
-        if (!m_BlueChannel.empty())
-            m_BlueChannel = m_BlueChannel.clone(); // Already grayscale
-        if (!m_AlphaChannel.empty())
-            m_AlphaChannel = m_AlphaChannel.clone(); // Already grayscale
-    }
-    else
+    m_RedChannel = extractChannel(0, 2);
+    m_GreenChannel = extractChannel(1, 1);
+    m_BlueChannel = extractChannel(2, 0);
+    m_AlphaChannel = extractChannel(3, 3);
+    if (context.IsCancelled())
+        return;
+    
+    // Extracted channels are already single-channel grayscale images, so grayscale
+    // output needs no further work. Otherwise colorize them for visualization.
+    if (!m_ProcessParams.OutputGrayscale)
     {
         // Convert single-channel images to 3-channel for visualization
         if (!m_RedChannel.empty())
@@ -107,13 +93,12 @@ void ColorChannelSplitterNode::Process()
             cv::merge(blueChannels, m_BlueChannel);
         }
         
-        if (!m_AlphaChannel.empty())
-        {
-            // For alpha, we'll create a grayscale visualization
-            m_AlphaChannel = m_AlphaChannel.clone();
-        }
+        // Alpha keeps its grayscale visualization
     }
     
+    if (context.IsCancelled())
+        return;
+    
     // Set the output images in the ImageDataManager
     if (!Outputs.empty() && Outputs.size() >= 4)
     {
@@ -122,35 +107,77 @@ void ColorChannelSplitterNode::Process()
         ImageDataManager::GetInstance().SetImageData(Outputs[2].ID, m_BlueChannel);
         ImageDataManager::GetInstance().SetImageData(Outputs[3].ID, m_AlphaChannel);
     }
-    
-    // Update preview textures
+}
+
+void ColorChannelSplitterNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void ColorChannelSplitterNode::PreparePreview()
+{
+    m_RedPreview = MakePreviewImage(m_RedChannel);
+    m_GreenPreview = MakePreviewImage(m_GreenChannel);
+    m_BluePreview = MakePreviewImage(m_BlueChannel);
+    m_AlphaPreview = MakePreviewImage(m_AlphaChannel);
+}
+
+void ColorChannelSplitterNode::UpdatePreview()
+{
+    m_DisplaySize = m_InputImage.size();
+
+    // Re-create the channel previews from the latest outputs (empty channels get none)
     UpdatePreviewTextures();
 }
 
+void ColorChannelSplitterNode::ReleaseResults()
+{
+    Node::ReleaseResults();
+
+    // The channel previews and the display size are kept, the images they were made from are not
+    m_RedChannel.release();
+    m_GreenChannel.release();
+    m_BlueChannel.release();
+    m_AlphaChannel.release();
+}
+
+void ColorChannelSplitterNode::ReleaseInputs()
+{
+    m_InputImage.release();
+}
+
+void ColorChannelSplitterNode::GetHeldImages(std::vector<cv::Mat>& images) const
+{
+    Node::GetHeldImages(images);
+    for (const cv::Mat* image : { &m_InputImage, &m_RedChannel, &m_GreenChannel, &m_BlueChannel, &m_AlphaChannel,
+        &m_RedPreview, &m_GreenPreview, &m_BluePreview, &m_AlphaPreview })
+        images.push_back(*image);
+}
+
 void ColorChannelSplitterNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
 
-    ImGui::Checkbox("Output as Grayscale", &m_OutputGrayscale);
+    ImGui::Checkbox("Output as Grayscale", &m_Params.OutputGrayscale);
     
     if (ImGui::IsItemEdited())
     {
-        Dirty = true;
+        SetDirty(true);
     }
     
     ImGui::Separator();
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Previews", &m_ShowPreview);
+    DrawPreviewCheckbox("Show Previews");
 
     if (m_ShowPreview) {
         // Calculate small preview size
     const float previewWidth = 80.0f;
     float previewHeight = previewWidth;
     
-    if (!m_InputImage.empty())
+    if (!m_DisplaySize.empty())
     {
-        float aspectRatio = (float)m_InputImage.cols / (float)m_InputImage.rows;
+        float aspectRatio = (float)m_DisplaySize.width / (float)m_DisplaySize.height;
         previewHeight = previewWidth / aspectRatio;
     }
     
@@ -206,66 +233,18 @@ void ColorChannelSplitterNode::UpdatePreviewTextures()
     ImageEditorApp* app = ImageEditorApp::GetInstance();
     if (!app) return;
     
-    // Create textures for each channel
-    if (!m_RedChannel.empty())
-    {
-        cv::Mat displayImage;
-        if (m_RedChannel.channels() == 3)
-            cv::cvtColor(m_RedChannel, displayImage, cv::COLOR_BGR2RGBA);
-        else if (m_RedChannel.channels() == 4)
-            cv::cvtColor(m_RedChannel, displayImage, cv::COLOR_BGRA2RGBA);
-        else if (m_RedChannel.channels() == 1)
-            cv::cvtColor(m_RedChannel, displayImage, cv::COLOR_GRAY2RGBA);
-        else
-            displayImage = m_RedChannel.clone();
-            
-        m_RedTexture = app->CreateTexture(displayImage.data, displayImage.cols, displayImage.rows);
-    }
+    // Create textures for each channel from the RGBA previews made on the evaluation thread
+    if (!m_RedPreview.empty())
+        m_RedTexture = app->CreateTexture(m_RedPreview.data, m_RedPreview.cols, m_RedPreview.rows);
     
-    if (!m_GreenChannel.empty())
-    {
-        cv::Mat displayImage;
-        if (m_GreenChannel.channels() == 3)
-            cv::cvtColor(m_GreenChannel, displayImage, cv::COLOR_BGR2RGBA);
-        else if (m_GreenChannel.channels() == 4)
-            cv::cvtColor(m_GreenChannel, displayImage, cv::COLOR_BGRA2RGBA);
-        else if (m_GreenChannel.channels() == 1)
-            cv::cvtColor(m_GreenChannel, displayImage, cv::COLOR_GRAY2RGBA);
-        else
-            displayImage = m_GreenChannel.clone();
-            
-        m_GreenTexture = app->CreateTexture(displayImage.data, displayImage.cols, displayImage.rows);
-    }
+    if (!m_GreenPreview.empty())
+        m_GreenTexture = app->CreateTexture(m_GreenPreview.data, m_GreenPreview.cols, m_GreenPreview.rows);
     
-    if (!m_BlueChannel.empty())
-    {
-        cv::Mat displayImage;
-        if (m_BlueChannel.channels() == 3)
-            cv::cvtColor(m_BlueChannel, displayImage, cv::COLOR_BGR2RGBA);
-        else if (m_BlueChannel.channels() == 4)
-            cv::cvtColor(m_BlueChannel, displayImage, cv::COLOR_BGRA2RGBA);
-        else if (m_BlueChannel.channels() == 1)
-            cv::cvtColor(m_BlueChannel, displayImage, cv::COLOR_GRAY2RGBA);
-        else
-            displayImage = m_BlueChannel.clone();
-            
-        m_BlueTexture = app->CreateTexture(displayImage.data, displayImage.cols, displayImage.rows);
-    }
+    if (!m_BluePreview.empty())
+        m_BlueTexture = app->CreateTexture(m_BluePreview.data, m_BluePreview.cols, m_BluePreview.rows);
     
-    if (!m_AlphaChannel.empty())
-    {
-        cv::Mat displayImage;
-        if (m_AlphaChannel.channels() == 3)
-            cv::cvtColor(m_AlphaChannel, displayImage, cv::COLOR_BGR2RGBA);
-        else if (m_AlphaChannel.channels() == 4)
-            cv::cvtColor(m_AlphaChannel, displayImage, cv::COLOR_BGRA2RGBA);
-        else if (m_AlphaChannel.channels() == 1)
-            cv::cvtColor(m_AlphaChannel, displayImage, cv::COLOR_GRAY2RGBA);
-        else
-            displayImage = m_AlphaChannel.clone();
-            
-        m_AlphaTexture = app->CreateTexture(displayImage.data, displayImage.cols, displayImage.rows);
-    }
+    if (!m_AlphaPreview.empty())
+        m_AlphaTexture = app->CreateTexture(m_AlphaPreview.data, m_AlphaPreview.cols, m_AlphaPreview.rows);
 }
 
 void ColorChannelSplitterNode::CleanupTextures()
@@ -8,8 +8,14 @@ public:
     ~ColorChannelSplitterNode() override = default;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void PreparePreview() override;
+    void UpdatePreview() override;
+    void ReleaseResults() override;
+    void ReleaseInputs() override;
+    void GetHeldImages(std::vector<cv::Mat>& images) const override;
 
 private:
     // Input/Output images
@@ -20,8 +26,18 @@ private:
     cv::Mat m_AlphaChannel;
     
     // Display options
-    bool m_OutputGrayscale = true;
-    bool m_ShowPreview = true; // Added for optional preview
+    struct Parameters {
+        bool OutputGrayscale = true;
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
+
+    // RGBA previews of the channels, prepared on the evaluation thread
+    cv::Mat m_RedPreview;
+    cv::Mat m_GreenPreview;
+    cv::Mat m_BluePreview;
+    cv::Mat m_AlphaPreview;
+    cv::Size m_DisplaySize; // Input size of the last completed evaluation
 
     // Preview textures
     ImTextureID m_RedTexture = nullptr;
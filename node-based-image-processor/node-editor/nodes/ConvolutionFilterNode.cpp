@@ -4,6 +4,7 @@
 #include <imgui.h>
 #include <vector>
 #include <numeric> // For std::accumulate
+#include <algorithm>
 
 ConvolutionFilterNode::ConvolutionFilterNode(int id)
     : Node(id, "Convolution Filter", ImColor(150, 150, 150))
@@ -24,7 +25,7 @@ ConvolutionFilterNode::~ConvolutionFilterNode()
     CleanupTexture();
 }
 
-void ConvolutionFilterNode::Process()
+void ConvolutionFilterNode::Process(const EvaluationContext& context)
 {
     // Get input image
     if (!Inputs.empty())
@@ -39,23 +40,81 @@ void ConvolutionFilterNode::Process()
     if (m_InputImage.empty())
     {
         m_OutputImage = cv::Mat();
-        CleanupTexture();
         return;
     }
 
-    // Apply convolution using the current kernel
-    cv::filter2D(m_InputImage, m_OutputImage, -1, m_Kernel);
+    // Apply convolution using the current kernel, band by band so it can be cancelled
+    // Write into a fresh buffer - the previous output may still be shared with consumers
+    cv::Mat result(m_InputImage.size(), m_InputImage.type());
+    bool completed = context.ForEachRowBand(m_InputImage.rows, [&](const cv::Range& rows)
+    {
+        cv::Mat resultBand = result.rowRange(rows);
+        ProcessTile(m_InputImage.rowRange(rows), resultBand);
+    });
+    if (!completed)
+        return;
+
+    m_OutputImage = result;
 
     // Set output image
     if (!Outputs.empty())
     {
         ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
     }
+}
+
+void ConvolutionFilterNode::CaptureParameters()
+{
+    m_ProcessKernel = m_Kernel;
+}
 
-    // Update preview
+void ConvolutionFilterNode::ScaleParameters(double scale)
+{
+    // The kernel covers a footprint in pixels. Shrink it with the image (never below
+    // 3x3) and rescale the taps so they keep their sum, which preserves the brightness
+    // of smoothing kernels and the zero response of edge kernels.
+    int size = std::max(3, cvRound(m_Kernel.rows * scale) | 1);
+    if (size >= m_Kernel.rows)
+        return;
+    
+    cv::Mat kernel;
+    cv::resize(m_Kernel, kernel, cv::Size(size, size), 0, 0, cv::INTER_AREA);
+    double areaRatio = (double)(m_Kernel.rows * m_Kernel.cols) / (size * size);
+    m_ProcessKernel = kernel * areaRatio;
+}
+
+void ConvolutionFilterNode::UpdatePreview()
+{
+    // Re-create the preview from the latest output (or drop it if there is none)
     UpdatePreviewTexture();
 }
 
+void ConvolutionFilterNode::ReleaseInputs()
+{
+    m_InputImage.release();
+}
+
+int ConvolutionFilterNode::GetInputHalo() const
+{
+    return std::max(m_ProcessKernel.rows, m_ProcessKernel.cols) / 2;
+}
+
+bool ConvolutionFilterNode::GetParameterHash(size_t& hash) const
+{
+    hash = 0;
+    HashCombine(hash, m_ProcessKernel.rows);
+    HashCombine(hash, m_ProcessKernel.cols);
+    for (auto it = m_ProcessKernel.begin<float>(); it != m_ProcessKernel.end<float>(); ++it)
+        HashCombine(hash, *it);
+    return true;
+}
+
+void ConvolutionFilterNode::ProcessTile(const cv::Mat& input, cv::Mat& output) const
+{
+    // filter2D reads the pixels around a submatrix from its parent image
+    cv::filter2D(input, output, -1, m_ProcessKernel);
+}
+
 void ConvolutionFilterNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
@@ -137,21 +196,21 @@ void ConvolutionFilterNode::DrawNodeContent()
     if (changed)
     {
         UpdateKernelFromUI();
-        Dirty = true;
+        SetDirty(true);
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    if (m_ShowPreview && !m_OutputImage.empty() && m_PreviewTexture)
+    if (m_ShowPreview && !m_DisplayImage.empty() && m_PreviewTexture)
     {
         ImGui::Separator();
         ImGui::Text("Preview:");
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
         if (previewHeight > maxPreviewHeight)
         {
@@ -233,27 +292,11 @@ void ConvolutionFilterNode::ApplyPreset(int presetIndex)
 void ConvolutionFilterNode::UpdatePreviewTexture()
 {
     CleanupTexture();
-    if (m_OutputImage.empty() || m_OutputImage.data == nullptr) return;
-
-    cv::Mat rgbaImage;
-    try {
-        if (m_OutputImage.channels() == 3)
-            cv::cvtColor(m_OutputImage, rgbaImage, cv::COLOR_BGR2RGBA);
-        else if (m_OutputImage.channels() == 4)
-             cv::cvtColor(m_OutputImage, rgbaImage, cv::COLOR_BGRA2RGBA);
-        else if (m_OutputImage.channels() == 1)
-            cv::cvtColor(m_OutputImage, rgbaImage, cv::COLOR_GRAY2RGBA);
-        else
-            rgbaImage = m_OutputImage.clone(); // Should not happen with filter2D
-    } catch (const cv::Exception& e) {
-        // Handle potential conversion errors
-        return;
-    }
-
+    if (m_PreviewImage.empty()) return; // RGBA preview is prepared on the evaluation thread
 
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbaImage.data, rgbaImage.cols, rgbaImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
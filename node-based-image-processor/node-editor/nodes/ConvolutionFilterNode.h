@@ -10,8 +10,15 @@ public:
     ConvolutionFilterNode(int id);
     ~ConvolutionFilterNode() override; // Add virtual destructor
 
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void ScaleParameters(double scale) override;
+    int GetInputHalo() const override;
+    bool GetParameterHash(size_t& hash) const override;
+    void ProcessTile(const cv::Mat& input, cv::Mat& output) const override;
+    void UpdatePreview() override;
+    void ReleaseInputs() override;
 
 private:
     void UpdatePreviewTexture();
@@ -22,12 +29,12 @@ private:
     cv::Mat m_InputImage;
     // m_OutputImage is inherited from Node base class
     void* m_PreviewTexture = nullptr; // Use void* for texture handle
-    bool m_ShowPreview = true; // Added for optional preview
 
     // Kernel parameters
     int m_KernelSize = 3; // 3 for 3x3, 5 for 5x5
     std::vector<float> m_KernelValues; // Flattened kernel matrix
-    cv::Mat m_Kernel; // OpenCV kernel matrix
+    cv::Mat m_Kernel; // OpenCV kernel matrix, rebuilt (never modified) by UpdateKernelFromUI
+    cv::Mat m_ProcessKernel; // Snapshot of m_Kernel used by Process()
 
     // Presets
     enum Preset { SHARPEN, EMBOSS, EDGE_ENHANCE };
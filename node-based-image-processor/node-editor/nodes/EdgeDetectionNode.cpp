@@ -13,7 +13,7 @@ EdgeDetectionNode::EdgeDetectionNode(int id)
     AddOutputPin("Image", PinType::Image);
 }
 
-void EdgeDetectionNode::Process()
+void EdgeDetectionNode::Process(const EvaluationContext& context)
 {
     // Get input image from the ImageDataManager
     if (!Inputs.empty())
@@ -28,23 +28,38 @@ void EdgeDetectionNode::Process()
     if (m_InputImage.empty())
     {
 		m_OutputImage = cv::Mat();
-        CleanupTexture();
         return;
     }
     
     // Apply the edge detection algorithm based on current settings
-    m_OutputImage = ApplyEdgeDetection(m_InputImage);
+    cv::Mat result = ApplyEdgeDetection(m_InputImage, context);
+    if (result.empty())
+        return; // Cancelled
+    m_OutputImage = result;
     
     // Set the output image in the ImageDataManager
     if (!m_OutputImage.empty() && !Outputs.empty())
     {
         ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
     }
-    
-    // Update the preview texture
+}
+
+void EdgeDetectionNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void EdgeDetectionNode::UpdatePreview()
+{
+    // Re-create the preview from the latest output (or drop it if there is none)
     UpdatePreviewTexture();
 }
 
+void EdgeDetectionNode::ReleaseInputs()
+{
+    m_InputImage.release();
+}
+
 void EdgeDetectionNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
@@ -55,12 +70,12 @@ void EdgeDetectionNode::DrawNodeContent()
     // Select detection type
     ImGui::PushItemWidth(itemWidth);
     const char* detectionTypes[] = { "Sobel", "Canny", "Laplacian" };
-    changed |= ImGui::Combo("Detection Type", &m_DetectionType, detectionTypes, 3);
+    changed |= ImGui::Combo("Detection Type", &m_Params.DetectionType, detectionTypes, 3);
     ImGui::PopItemWidth();
 
     // Show parameters based on selected type
     ImGui::PushItemWidth(itemWidth);
-    if (m_DetectionType == 0) // Sobel
+    if (m_Params.DetectionType == 0) // Sobel
     {
         int kernelSizes[] = { 1, 3, 5, 7 };
         int kernelSizeIndex = 0;
@@ -68,7 +83,7 @@ void EdgeDetectionNode::DrawNodeContent()
         // Find the current kernel size index
         for (int i = 0; i < 4; i++)
         {
-            if (kernelSizes[i] == m_SobelKernelSize)
+            if (kernelSizes[i] == m_Params.SobelKernelSize)
             {
                 kernelSizeIndex = i;
                 break;
@@ -79,42 +94,42 @@ void EdgeDetectionNode::DrawNodeContent()
         const char* kernelLabels[] = { "1x1", "3x3", "5x5", "7x7" };
         if (ImGui::Combo("Kernel Size", &kernelSizeIndex, kernelLabels, 4))
         {
-            m_SobelKernelSize = kernelSizes[kernelSizeIndex];
+            m_Params.SobelKernelSize = kernelSizes[kernelSizeIndex];
             changed = true;
         }
 
         // X and Y derivative orders
-        changed |= ImGui::SliderInt("X Derivative", &m_SobelDx, 0, 2);
-        changed |= ImGui::SliderInt("Y Derivative", &m_SobelDy, 0, 2);
+        changed |= ImGui::SliderInt("X Derivative", &m_Params.SobelDx, 0, 2);
+        changed |= ImGui::SliderInt("Y Derivative", &m_Params.SobelDy, 0, 2);
 
         // Ensure at least one derivative is used
-        if (m_SobelDx == 0 && m_SobelDy == 0)
+        if (m_Params.SobelDx == 0 && m_Params.SobelDy == 0)
         {
-            m_SobelDx = 1;
+            m_Params.SobelDx = 1;
             changed = true;
         }
     }
-    else if (m_DetectionType == 1) // Canny
+    else if (m_Params.DetectionType == 1) // Canny
     {
-        float threshold1 = static_cast<float>(m_CannyThreshold1);
-        float threshold2 = static_cast<float>(m_CannyThreshold2);
+        float threshold1 = static_cast<float>(m_Params.CannyThreshold1);
+        float threshold2 = static_cast<float>(m_Params.CannyThreshold2);
 
         if (ImGui::SliderFloat("Threshold 1", &threshold1, 0.0f, 300.0f))
         {
-            m_CannyThreshold1 = static_cast<double>(threshold1);
+            m_Params.CannyThreshold1 = static_cast<double>(threshold1);
             changed = true;
         }
 
         if (ImGui::SliderFloat("Threshold 2", &threshold2, 0.0f, 300.0f))
         {
-            m_CannyThreshold2 = static_cast<double>(threshold2);
+            m_Params.CannyThreshold2 = static_cast<double>(threshold2);
             changed = true;
         }
 
         // Ensure threshold1 <= threshold2
-        if (m_CannyThreshold1 > m_CannyThreshold2)
+        if (m_Params.CannyThreshold1 > m_Params.CannyThreshold2)
         {
-            m_CannyThreshold1 = m_CannyThreshold2;
+            m_Params.CannyThreshold1 = m_Params.CannyThreshold2;
             changed = true;
         }
         
@@ -124,7 +139,7 @@ void EdgeDetectionNode::DrawNodeContent()
         // Find the current aperture size index
         for (int i = 0; i < 3; i++)
         {
-            if (apertureSizes[i] == m_CannyApertureSize)
+            if (apertureSizes[i] == m_Params.CannyApertureSize)
             {
                 apertureSizeIndex = i;
                 break;
@@ -135,13 +150,13 @@ void EdgeDetectionNode::DrawNodeContent()
         const char* apertureLabels[] = { "3x3", "5x5", "7x7" };
         if (ImGui::Combo("Aperture Size", &apertureSizeIndex, apertureLabels, 3))
         {
-            m_CannyApertureSize = apertureSizes[apertureSizeIndex];
+            m_Params.CannyApertureSize = apertureSizes[apertureSizeIndex];
             changed = true;
         }
 
-        changed |= ImGui::Checkbox("L2 Gradient", &m_CannyL2Gradient);
+        changed |= ImGui::Checkbox("L2 Gradient", &m_Params.CannyL2Gradient);
     }
-    else if (m_DetectionType == 2) // Laplacian
+    else if (m_Params.DetectionType == 2) // Laplacian
     {
         int kernelSizes[] = { 1, 3, 5, 7 };
         int kernelSizeIndex = 0;
@@ -149,7 +164,7 @@ void EdgeDetectionNode::DrawNodeContent()
         // Find the current kernel size index
         for (int i = 0; i < 4; i++)
         {
-            if (kernelSizes[i] == m_LaplacianKernelSize)
+            if (kernelSizes[i] == m_Params.LaplacianKernelSize)
             {
                 kernelSizeIndex = i;
                 break;
@@ -160,21 +175,21 @@ void EdgeDetectionNode::DrawNodeContent()
         const char* kernelLabels[] = { "1x1", "3x3", "5x5", "7x7" };
         if (ImGui::Combo("Kernel Size", &kernelSizeIndex, kernelLabels, 4))
         {
-            m_LaplacianKernelSize = kernelSizes[kernelSizeIndex];
+            m_Params.LaplacianKernelSize = kernelSizes[kernelSizeIndex];
             changed = true;
         }
 
-        float scale = static_cast<float>(m_LaplacianScale);
+        float scale = static_cast<float>(m_Params.LaplacianScale);
         if (ImGui::SliderFloat("Scale", &scale, 0.1f, 5.0f))
         {
-            m_LaplacianScale = static_cast<double>(scale);
+            m_Params.LaplacianScale = static_cast<double>(scale);
             changed = true;
         }
 
-        float delta = static_cast<float>(m_LaplacianDelta);
+        float delta = static_cast<float>(m_Params.LaplacianDelta);
         if (ImGui::SliderFloat("Delta", &delta, -100.0f, 100.0f))
         {
-            m_LaplacianDelta = static_cast<double>(delta);
+            m_Params.LaplacianDelta = static_cast<double>(delta);
             changed = true;
         }
     }
@@ -183,14 +198,14 @@ void EdgeDetectionNode::DrawNodeContent()
     // Mark node as dirty if any parameter changed
     if (changed)
     {
-        Dirty = true;
+        SetDirty(true);
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    if (m_ShowPreview && !m_OutputImage.empty() && m_PreviewTexture)
+    if (m_ShowPreview && !m_DisplayImage.empty() && m_PreviewTexture)
     {
         ImGui::Separator();
         ImGui::Text("Preview:");
@@ -199,8 +214,8 @@ void EdgeDetectionNode::DrawNodeContent()
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
 
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
 
         if (previewHeight > maxPreviewHeight)
@@ -220,29 +235,19 @@ void EdgeDetectionNode::DrawNodeContent()
 	ImGui::PopID(); // Pop ID for this node instance
 }
 
-cv::Mat EdgeDetectionNode::ApplyEdgeDetection(const cv::Mat& inputImage)
+cv::Mat EdgeDetectionNode::DetectLocalEdges(const cv::Mat& grayImage) const
 {
-    if (inputImage.empty())
-        return cv::Mat();
-    
-    cv::Mat grayImage;
-    cv::Mat result;
-    
-    // Convert to grayscale if needed
-    if (inputImage.channels() == 1)
-        grayImage = inputImage.clone();
-    else
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
+    const Parameters& params = m_ProcessParams;
+    cv::Mat edges;
     
-    // Apply edge detection based on selected type
-    if (m_DetectionType == 0) // Sobel
+    if (params.DetectionType == 0) // Sobel
     {
-        cv::Mat gradX, gradY, gradMag;
+        cv::Mat gradX, gradY;
         
         // Apply Sobel in X direction
-        if (m_SobelDx > 0)
+        if (params.SobelDx > 0)
         {
-            cv::Sobel(grayImage, gradX, CV_16S, m_SobelDx, 0, m_SobelKernelSize);
+            cv::Sobel(grayImage, gradX, CV_16S, params.SobelDx, 0, params.SobelKernelSize);
             cv::convertScaleAbs(gradX, gradX);
         }
         else
@@ -251,9 +256,9 @@ cv::Mat EdgeDetectionNode::ApplyEdgeDetection(const cv::Mat& inputImage)
         }
         
         // Apply Sobel in Y direction
-        if (m_SobelDy > 0)
+        if (params.SobelDy > 0)
         {
-            cv::Sobel(grayImage, gradY, CV_16S, 0, m_SobelDy, m_SobelKernelSize);
+            cv::Sobel(grayImage, gradY, CV_16S, 0, params.SobelDy, params.SobelKernelSize);
             cv::convertScaleAbs(gradY, gradY);
         }
         else
@@ -262,28 +267,147 @@ cv::Mat EdgeDetectionNode::ApplyEdgeDetection(const cv::Mat& inputImage)
         }
         
         // Combine results
-        cv::addWeighted(gradX, 0.5, gradY, 0.5, 0, result);
+        cv::addWeighted(gradX, 0.5, gradY, 0.5, 0, edges);
     }
-    else if (m_DetectionType == 1) // Canny
+    else if (params.DetectionType == 2) // Laplacian
     {
-        cv::Canny(grayImage, result, m_CannyThreshold1, m_CannyThreshold2, m_CannyApertureSize, m_CannyL2Gradient);
+        cv::Mat laplacianResult;
+        cv::Laplacian(grayImage, laplacianResult, CV_16S, params.LaplacianKernelSize, params.LaplacianScale, params.LaplacianDelta);
+        cv::convertScaleAbs(laplacianResult, edges);
     }
-    else if (m_DetectionType == 2) // Laplacian
+    
+    return edges;
+}
+
+int EdgeDetectionNode::GetInputHalo() const
+{
+    // Kernel size 1 still uses a 3-tap kernel. Canny follows edges across the whole image.
+    if (m_ProcessParams.DetectionType == 0)
+        return std::max(1, m_ProcessParams.SobelKernelSize / 2);
+    if (m_ProcessParams.DetectionType == 2)
+        return std::max(1, m_ProcessParams.LaplacianKernelSize / 2);
+    return -1;
+}
+
+bool EdgeDetectionNode::GetParameterHash(size_t& hash) const
+{
+    hash = 0;
+    HashCombine(hash, m_ProcessParams.DetectionType);
+    HashCombine(hash, m_ProcessParams.SobelKernelSize);
+    HashCombine(hash, m_ProcessParams.SobelDx);
+    HashCombine(hash, m_ProcessParams.SobelDy);
+    HashCombine(hash, m_ProcessParams.CannyThreshold1);
+    HashCombine(hash, m_ProcessParams.CannyThreshold2);
+    HashCombine(hash, m_ProcessParams.CannyApertureSize);
+    HashCombine(hash, m_ProcessParams.CannyL2Gradient);
+    HashCombine(hash, m_ProcessParams.LaplacianKernelSize);
+    HashCombine(hash, m_ProcessParams.LaplacianScale);
+    HashCombine(hash, m_ProcessParams.LaplacianDelta);
+    return true;
+}
+
+void EdgeDetectionNode::ProcessTile(const cv::Mat& input, cv::Mat& output) const
+{
+    cv::Mat grayTile;
+    if (input.channels() == 1)
     {
-        cv::Mat laplacianResult;
-        cv::Laplacian(grayImage, laplacianResult, CV_16S, m_LaplacianKernelSize, m_LaplacianScale, m_LaplacianDelta);
-        cv::convertScaleAbs(laplacianResult, result);
+        grayTile = input;
+    }
+    else
+    {
+        // The derivatives need the halo in grayscale too, so convert the region of the
+        // parent image around the tile and filter the tile's part of the result
+        cv::Size wholeSize;
+        cv::Point tileOffset, expandedOffset;
+        input.locateROI(wholeSize, tileOffset);
+        
+        const int halo = GetInputHalo();
+        cv::Mat expanded = input;
+        expanded.adjustROI(halo, halo, halo, halo); // Clipped to the parent image
+        expanded.locateROI(wholeSize, expandedOffset);
+        
+        cv::Mat grayExpanded;
+        cv::cvtColor(expanded, grayExpanded, cv::COLOR_BGR2GRAY);
+        grayTile = grayExpanded(cv::Rect(tileOffset - expandedOffset, input.size()));
+    }
+    
+    cv::Mat edges = DetectLocalEdges(grayTile);
+    if (input.channels() > 1)
+        cv::cvtColor(edges, output, cv::COLOR_GRAY2BGR);
+    else
+        edges.copyTo(output);
+}
+
+cv::Mat EdgeDetectionNode::ApplyEdgeDetection(const cv::Mat& inputImage, const EvaluationContext& context)
+{
+    if (inputImage.empty())
+        return cv::Mat();
+    
+    const Parameters& params = m_ProcessParams;
+    const bool colorOutput = inputImage.channels() > 1;
+    const int rows = inputImage.rows;
+    
+    // Convert to grayscale if needed
+    cv::Mat grayImage;
+    if (inputImage.channels() == 1)
+    {
+        grayImage = inputImage; // Read-only use, no copy needed
+    }
+    else
+    {
+        grayImage.create(inputImage.size(), CV_8UC1);
+        bool completed = context.ForEachRowBand(rows, [&](const cv::Range& band)
+        {
+            cv::Mat grayBand = grayImage.rowRange(band);
+            cv::cvtColor(inputImage.rowRange(band), grayBand, cv::COLOR_BGR2GRAY);
+        });
+        if (!completed)
+            return cv::Mat();
     }
     
-    // Convert result to 3-channel if input was 3-channel
-    if (inputImage.channels() > 1)
+    // Store a band of the grayscale edge map, converted to 3-channel if input was 3-channel
+    cv::Mat result(inputImage.size(), colorOutput ? CV_8UC3 : CV_8UC1);
+    auto storeBand = [&](const cv::Range& band, const cv::Mat& edges)
+    {
+        cv::Mat resultBand = result.rowRange(band);
+        if (colorOutput)
+            cv::cvtColor(edges, resultBand, cv::COLOR_GRAY2BGR);
+        else
+            edges.copyTo(resultBand);
+    };
+    
+    // Apply edge detection based on selected type. Sobel and Laplacian only look at a
+    // small neighborhood and run band by band; Canny's hysteresis follows edges across
+    // the whole image, so it can only be cancelled before and after it runs.
+    bool completed = true;
+    if (params.DetectionType == 0) // Sobel
     {
-        cv::Mat colorResult;
-        cv::cvtColor(result, colorResult, cv::COLOR_GRAY2BGR);
-        return colorResult;
+        completed = context.ForEachRowBand(rows, [&](const cv::Range& band)
+        {
+            storeBand(band, DetectLocalEdges(grayImage.rowRange(band)));
+        });
+    }
+    else if (params.DetectionType == 1) // Canny
+    {
+        if (context.IsCancelled())
+            return cv::Mat();
+        
+        cv::Mat edges;
+        cv::Canny(grayImage, edges, params.CannyThreshold1, params.CannyThreshold2, params.CannyApertureSize, params.CannyL2Gradient);
+        completed = context.ForEachRowBand(rows, [&](const cv::Range& band)
+        {
+            storeBand(band, edges.rowRange(band));
+        });
+    }
+    else if (params.DetectionType == 2) // Laplacian
+    {
+        completed = context.ForEachRowBand(rows, [&](const cv::Range& band)
+        {
+            storeBand(band, DetectLocalEdges(grayImage.rowRange(band)));
+        });
     }
     
-    return result;
+    return completed ? result : cv::Mat();
 }
 
 void EdgeDetectionNode::UpdatePreviewTexture()
@@ -291,29 +415,14 @@ void EdgeDetectionNode::UpdatePreviewTexture()
     // Clean up any existing texture
     CleanupTexture();
     
-    // Use the local output image
-    if (m_OutputImage.empty())
-        return;
-    
-    // Verify we have valid image data
-    if (m_OutputImage.data == nullptr)
+    // The RGBA preview was already prepared on the evaluation thread
+    if (m_PreviewImage.empty())
         return;
 
-    // Convert image from OpenCV BGR format to RGB for OpenGL
-    cv::Mat rgbImage;
-    if (m_OutputImage.channels() == 3)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGR2RGBA);
-    else if (m_OutputImage.channels() == 4)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGRA2RGBA);
-    else if (m_OutputImage.channels() == 1)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_GRAY2RGBA);
-    else
-        rgbImage = m_OutputImage.clone(); // Just use as-is if format is unexpected
-    
     // Use ImageEditorApp singleton to create texture instead of direct OpenGL calls
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbImage.data, rgbImage.cols, rgbImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
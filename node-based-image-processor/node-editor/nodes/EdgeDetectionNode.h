@@ -8,37 +8,47 @@ public:
     ~EdgeDetectionNode() override = default;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    int GetInputHalo() const override;
+    bool GetParameterHash(size_t& hash) const override;
+    void ProcessTile(const cv::Mat& input, cv::Mat& output) const override;
+    void UpdatePreview() override;
+    void ReleaseInputs() override;
 
 private:
     // Input/Output images
     cv::Mat m_InputImage;
     // m_OutputImage is inherited from Node base class
     ImTextureID m_PreviewTexture = nullptr;
-    bool m_ShowPreview = true; // Added for optional preview
 
     // Edge detection parameters
-    int m_DetectionType = 0;      // 0: Sobel, 1: Canny, 2: Laplacian
-    
-    // Sobel parameters
-    int m_SobelKernelSize = 3;    // 1, 3, 5, 7
-    int m_SobelDx = 1;            // x derivative order
-    int m_SobelDy = 1;            // y derivative order
-    
-    // Canny parameters
-    double m_CannyThreshold1 = 100.0;
-    double m_CannyThreshold2 = 200.0;
-    int m_CannyApertureSize = 3;  // 3, 5, 7
-    bool m_CannyL2Gradient = false;
-    
-    // Laplacian parameters
-    int m_LaplacianKernelSize = 3; // 1, 3, 5, 7
-    double m_LaplacianScale = 1.0;
-    double m_LaplacianDelta = 0.0;
+    struct Parameters {
+        int DetectionType = 0;      // 0: Sobel, 1: Canny, 2: Laplacian
+
+        // Sobel parameters
+        int SobelKernelSize = 3;    // 1, 3, 5, 7
+        int SobelDx = 1;            // x derivative order
+        int SobelDy = 1;            // y derivative order
+
+        // Canny parameters
+        double CannyThreshold1 = 100.0;
+        double CannyThreshold2 = 200.0;
+        int CannyApertureSize = 3;  // 3, 5, 7
+        bool CannyL2Gradient = false;
+
+        // Laplacian parameters
+        int LaplacianKernelSize = 3; // 1, 3, 5, 7
+        double LaplacianScale = 1.0;
+        double LaplacianDelta = 0.0;
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
     
     // Helper methods
     void UpdatePreviewTexture();
     void CleanupTexture();
-    cv::Mat ApplyEdgeDetection(const cv::Mat& inputImage);
+    cv::Mat ApplyEdgeDetection(const cv::Mat& inputImage, const EvaluationContext& context); // Empty if cancelled
+    cv::Mat DetectLocalEdges(const cv::Mat& grayImage) const; // Sobel or Laplacian, 8-bit
 };
@@ -26,11 +26,29 @@ InputNode::~InputNode()
     CleanupTexture();
 }
 
-void InputNode::Process()
+void InputNode::Process(const EvaluationContext& context)
 {
     // For input nodes, processing is just providing the loaded image
-    // The image is already loaded in LoadImageFile, so just pass it on
-    m_OutputImage = m_Image.clone();
+    // The image is already loaded in LoadImageFile, so just share it
+    m_OutputImage = m_ProcessImage;
+    
+    // While a slider is dragged the graph runs on a downscaled proxy of the image,
+    // kept for further edits at the same scale
+    const double scale = context.GetProxyScale();
+    if (scale < 1.0 && !m_ProcessImage.empty())
+    {
+        if (m_ProxyImage.empty() || m_ProxySource.data != m_ProcessImage.data || m_ProxyScale != scale)
+        {
+            // Resize into a fresh buffer, the previous proxy may still be shared with consumers
+            cv::Mat proxy;
+            cv::Size proxySize(std::max<int>(1, cvRound(m_ProcessImage.cols * scale)), std::max<int>(1, cvRound(m_ProcessImage.rows * scale)));
+            cv::resize(m_ProcessImage, proxy, proxySize, 0, 0, cv::INTER_AREA);
+            m_ProxyImage = proxy;
+            m_ProxySource = m_ProcessImage;
+            m_ProxyScale = scale;
+        }
+        m_OutputImage = m_ProxyImage;
+    }
     
     // Set the image data in the ImageDataManager for the output pin
     if (!m_OutputImage.empty() && !Outputs.empty())
@@ -39,9 +57,57 @@ void InputNode::Process()
     }
 }
 
+void InputNode::CaptureParameters()
+{
+    m_ProcessImage = m_Image;
+}
+
+bool InputNode::GetResultHash(size_t& hash) const
+{
+    // Downstream results are cached by the content of the image, hashed once per image.
+    // Only reads the hash, StartContentHash() computed it.
+    const ContentHash* contentHash = m_ContentHash.get();
+    if (m_ProcessImage.empty() || !contentHash || !contentHash->Ready ||
+        contentHash->Image.data != m_ProcessImage.data || contentHash->Image.size() != m_ProcessImage.size())
+        return false;
+
+    hash = contentHash->Value;
+    return true;
+}
+
+std::function<void()> InputNode::StartContentHash()
+{
+    // The worker only sees the shared state, the node may be deleted meanwhile
+    if (m_Image.empty() || (m_ContentHash && m_ContentHash->Image.data == m_Image.data && m_ContentHash->Image.size() == m_Image.size()))
+        return nullptr;
+
+    auto contentHash = std::make_shared<ContentHash>();
+    contentHash->Image = m_Image;
+    m_ContentHash = contentHash;
+    return [contentHash]
+    {
+        contentHash->Value = HashImage(contentHash->Image);
+        contentHash->Ready = true;
+    };
+}
+
+void InputNode::GetHeldImages(std::vector<cv::Mat>& images) const
+{
+    Node::GetHeldImages(images);
+    for (const cv::Mat* image : { &m_Image, &m_ProcessImage, &m_ProxyImage, &m_ProxySource })
+        images.push_back(*image);
+}
+
+void InputNode::PreparePreview()
+{
+    // The preview is made from the loaded file by LoadImageFile, nothing to do here
+}
+
 bool InputNode::LoadImageFile(const std::string& path)
 {
-    // Load image using OpenCV
+    // Load image using OpenCV. Images above BufferPool's mapped size decode straight into
+    // a scratch file mapping, so they need not fit in RAM. OpenCV refuses more pixels than
+    // the OPENCV_IO_MAX_IMAGE_PIXELS environment variable allows (2^30 by default).
     cv::Mat loadedImage = cv::imread(path, cv::IMREAD_UNCHANGED);
     if (loadedImage.empty())
     {
@@ -78,7 +144,7 @@ bool InputNode::LoadImageFile(const std::string& path)
     UpdatePreviewTexture();
     
     // Mark node as dirty to ensure it's processed
-    Dirty = true;
+    SetDirty(true);
     
     return true;
 }
@@ -219,17 +285,10 @@ void InputNode::UpdatePreviewTexture()
         return;
     }
     
-    // Convert image from OpenCV BGR format to RGB for texture creation
+    // Downscaled to preview size and converted to RGBA, like every other node's preview
     cv::Mat rgbImage;
     try {
-        if (m_Image.channels() == 3)
-            cv::cvtColor(m_Image, rgbImage, cv::COLOR_BGR2RGBA); // Convert to RGBA
-        else if (m_Image.channels() == 4)
-            cv::cvtColor(m_Image, rgbImage, cv::COLOR_BGRA2RGBA);
-        else if (m_Image.channels() == 1)
-            cv::cvtColor(m_Image, rgbImage, cv::COLOR_GRAY2RGBA);
-        else
-            rgbImage = m_Image.clone(); // Just use as-is if format is unexpected
+        rgbImage = MakePreviewImage(m_Image);
     }
     catch (const cv::Exception& e) {
         m_LastErrorMessage = "Image conversion error: " + std::string(e.what());
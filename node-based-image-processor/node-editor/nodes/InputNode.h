@@ -8,9 +8,14 @@ public:
     ~InputNode() override;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void PreparePreview() override;
     void OnSelected() override;
+    bool GetResultHash(size_t& hash) const override;
+    std::function<void()> StartContentHash() override;
+    void GetHeldImages(std::vector<cv::Mat>& images) const override;
 
     // Image loading functionality
     bool LoadImageFile(const std::string& path);  // Renamed from LoadImage to avoid Windows macro conflict
@@ -26,6 +31,18 @@ public:
 
 private:
     cv::Mat m_Image;
+    cv::Mat m_ProcessImage; // Snapshot of m_Image used by Process()
+    cv::Mat m_ProxyImage;   // Downscaled m_ProcessImage for interactive edits, see Process()
+    cv::Mat m_ProxySource;  // Image m_ProxyImage was made from
+    double m_ProxyScale = 1.0;
+    // Hash of an image's content, computed on a worker (see StartContentHash())
+    struct ContentHash
+    {
+        cv::Mat Image; // The image hashed
+        size_t Value = 0;
+        std::atomic<bool> Ready{ false };
+    };
+    std::shared_ptr<ContentHash> m_ContentHash;
     // m_OutputImage is already defined in Node class
     std::string m_FilePath;
     std::string m_FileFormat;
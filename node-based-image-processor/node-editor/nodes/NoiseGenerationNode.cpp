@@ -3,6 +3,7 @@
 #include "../../ImageEditorApp.h" // For texture handling
 #include <imgui.h>
 #include <opencv2/imgproc.hpp> // For cvtColor if needed
+#include <algorithm>
 
 NoiseGenerationNode::NoiseGenerationNode(int id)
     : Node(id, "Noise Generation", ImColor(180, 180, 50))
@@ -10,8 +11,7 @@ NoiseGenerationNode::NoiseGenerationNode(int id)
     // Setup pins - only output
     AddOutputPin("Noise", PinType::Image);
 
-    // Generate initial noise
-    GenerateNoise();
+    // The initial noise is generated by the first evaluation (new nodes start dirty)
 }
 
 NoiseGenerationNode::~NoiseGenerationNode()
@@ -19,16 +19,37 @@ NoiseGenerationNode::~NoiseGenerationNode()
     CleanupTexture();
 }
 
-void NoiseGenerationNode::Process()
+void NoiseGenerationNode::Process(const EvaluationContext& context)
 {
-    // Processing involves generating the noise based on current parameters
-    // The actual generation happens in GenerateNoise(), called when parameters change
-    // Here, we just ensure the output data manager has the latest generated image
+    // Processing involves generating the noise based on the parameter snapshot,
+    // so large images are generated on the evaluation thread
+    cv::Mat noise = GenerateNoise(context);
+    if (context.IsCancelled())
+        return;
+    m_OutputImage = noise;
+
     if (!Outputs.empty())
     {
         ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
     }
-    // Preview texture is updated within GenerateNoise()
+}
+
+void NoiseGenerationNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void NoiseGenerationNode::ScaleParameters(double scale)
+{
+    // Generate the noise at proxy size, so it matches the other downscaled inputs
+    m_ProcessParams.Width = std::max(1, cvRound(m_Params.Width * scale));
+    m_ProcessParams.Height = std::max(1, cvRound(m_Params.Height * scale));
+}
+
+void NoiseGenerationNode::UpdatePreview()
+{
+    // Re-create the preview from the latest output (or drop it if there is none)
+    UpdatePreviewTexture();
 }
 
 void NoiseGenerationNode::DrawNodeContent()
@@ -39,71 +60,70 @@ void NoiseGenerationNode::DrawNodeContent()
 
     // Output dimensions
     ImGui::PushItemWidth(80);
-    changed |= ImGui::InputInt("Width", &m_Width);
+    changed |= ImGui::InputInt("Width", &m_Params.Width);
     ImGui::SameLine();
-    changed |= ImGui::InputInt("Height", &m_Height);
+    changed |= ImGui::InputInt("Height", &m_Params.Height);
     ImGui::PopItemWidth();
 
     // Clamp dimensions
-    m_Width = std::max(1, m_Width);
-    m_Height = std::max(1, m_Height);
+    m_Params.Width = std::max(1, m_Params.Width);
+    m_Params.Height = std::max(1, m_Params.Height);
 
     const float itemWidth = 150.0f; // Define a width for the main widgets
 
     // Noise type selection
     ImGui::PushItemWidth(itemWidth);
     const char* noiseTypes[] = { "Uniform Random", "Gaussian Random" };
-    changed |= ImGui::Combo("Noise Type", &m_NoiseType, noiseTypes, IM_ARRAYSIZE(noiseTypes));
+    changed |= ImGui::Combo("Noise Type", &m_Params.NoiseType, noiseTypes, IM_ARRAYSIZE(noiseTypes));
     ImGui::PopItemWidth();
 
     // Color vs Grayscale
-    changed |= ImGui::Checkbox("Color Noise", &m_IsColor);
+    changed |= ImGui::Checkbox("Color Noise", &m_Params.IsColor);
 
     // Parameters based on noise type
-    if (m_NoiseType == 0) // Uniform Random
+    if (m_Params.NoiseType == 0) // Uniform Random
     {
         // No specific parameters for basic uniform noise yet
         ImGui::TextDisabled("Uniform distribution [0, 255]");
     }
-    else if (m_NoiseType == 1) // Gaussian Random
+    else if (m_Params.NoiseType == 1) // Gaussian Random
     {
         ImGui::PushItemWidth(itemWidth);
-        float mean = static_cast<float>(m_Mean);
-        float stddev = static_cast<float>(m_StdDev);
+        float mean = static_cast<float>(m_Params.Mean);
+        float stddev = static_cast<float>(m_Params.StdDev);
         changed |= ImGui::SliderFloat("Mean", &mean, 0.0f, 255.0f);
         changed |= ImGui::SliderFloat("Std Dev", &stddev, 0.0f, 100.0f);
         ImGui::PopItemWidth();
         if (changed) { // Check if sliders changed the value
              // Check if the sliders actually changed the value before assigning
-            bool meanChanged = (static_cast<double>(mean) != m_Mean);
-            bool stdDevChanged = (static_cast<double>(stddev) != m_StdDev);
-            if (meanChanged) m_Mean = static_cast<double>(mean);
-            if (stdDevChanged) m_StdDev = static_cast<double>(stddev);
+            bool meanChanged = (static_cast<double>(mean) != m_Params.Mean);
+            bool stdDevChanged = (static_cast<double>(stddev) != m_Params.StdDev);
+            if (meanChanged) m_Params.Mean = static_cast<double>(mean);
+            if (stdDevChanged) m_Params.StdDev = static_cast<double>(stddev);
             // 'changed' is already true if we entered this block due to slider interaction
         }
     }
 
     // General scale (might be more relevant for procedural noise later)
-    // changed |= ImGui::SliderFloat("Scale", &m_Scale, 0.1f, 10.0f);
+    // changed |= ImGui::SliderFloat("Scale", &m_Params.Scale, 0.1f, 10.0f);
 
     if (changed)
     {
-        GenerateNoise(); // Regenerate noise if parameters changed
-        Dirty = true;    // Mark as dirty to ensure Process() updates data manager
+        SetDirty(true);    // Mark as dirty so Process() regenerates the noise
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    if (m_ShowPreview && !m_OutputImage.empty() && m_PreviewTexture)
+    if (m_ShowPreview && !m_DisplayImage.empty() && m_PreviewTexture)
     {
         ImGui::Separator();
         ImGui::Text("Preview:");
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
         if (previewHeight > maxPreviewHeight)
         {
@@ -119,58 +139,41 @@ void NoiseGenerationNode::DrawNodeContent()
 	ImGui::PopID(); // Pop ID for this node instance
 }
 
-void NoiseGenerationNode::GenerateNoise()
+cv::Mat NoiseGenerationNode::GenerateNoise(const EvaluationContext& context)
 {
-    int channels = m_IsColor ? 3 : 1;
-    int type = m_IsColor ? CV_8UC3 : CV_8UC1;
+    int type = m_ProcessParams.IsColor ? CV_8UC3 : CV_8UC1;
 
     // Create the output image matrix
-    m_OutputImage = cv::Mat(m_Height, m_Width, type);
+    cv::Mat result(m_ProcessParams.Height, m_ProcessParams.Width, type);
 
-    // Generate noise based on type
-    if (m_NoiseType == 0) // Uniform Random
+    // Generate noise band by band based on type. Writing straight into the 8-bit
+    // result saturates to the valid [0, 255] range.
+    bool completed = context.ForEachRowBand(result.rows, [&](const cv::Range& rows)
     {
-        cv::randu(m_OutputImage, cv::Scalar::all(0), cv::Scalar::all(255));
-    }
-    else if (m_NoiseType == 1) // Gaussian Random
-    {
-        cv::Mat noise(m_Height, m_Width, type);
-        cv::randn(noise, cv::Scalar::all(m_Mean), cv::Scalar::all(m_StdDev));
-        // Ensure values are within the valid 8-bit range [0, 255]
-        noise.convertTo(m_OutputImage, type);
-    }
-    // Future: Add cases for Perlin, Simplex, Worley noise here
-
-    // Update the preview texture
-    UpdatePreviewTexture();
+        cv::Mat band = result.rowRange(rows);
+        if (m_ProcessParams.NoiseType == 0) // Uniform Random
+        {
+            cv::randu(band, cv::Scalar::all(0), cv::Scalar::all(255));
+        }
+        else if (m_ProcessParams.NoiseType == 1) // Gaussian Random
+        {
+            cv::randn(band, cv::Scalar::all(m_ProcessParams.Mean), cv::Scalar::all(m_ProcessParams.StdDev));
+        }
+        // Future: Add cases for Perlin, Simplex, Worley noise here
+    });
 
-     // Also ensure the data manager gets updated immediately in Process()
-    Dirty = true;
+    return completed ? result : cv::Mat();
 }
 
 
 void NoiseGenerationNode::UpdatePreviewTexture()
 {
     CleanupTexture();
-    if (m_OutputImage.empty() || m_OutputImage.data == nullptr) return;
-
-    cv::Mat rgbaImage;
-     try {
-        if (m_OutputImage.channels() == 3)
-            cv::cvtColor(m_OutputImage, rgbaImage, cv::COLOR_BGR2RGBA);
-        else if (m_OutputImage.channels() == 1)
-            cv::cvtColor(m_OutputImage, rgbaImage, cv::COLOR_GRAY2RGBA);
-        else // Should not happen for noise generation
-            rgbaImage = m_OutputImage.clone();
-     } catch (const cv::Exception& e) {
-         // Handle potential conversion errors
-         return;
-     }
-
+    if (m_PreviewImage.empty()) return; // RGBA preview is prepared on the evaluation thread
 
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbaImage.data, rgbaImage.cols, rgbaImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
@@ -9,26 +9,32 @@ public:
     NoiseGenerationNode(int id);
     ~NoiseGenerationNode() override;
 
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void ScaleParameters(double scale) override;
+    void UpdatePreview() override;
 
 private:
     void UpdatePreviewTexture();
     void CleanupTexture();
-    void GenerateNoise();
+    cv::Mat GenerateNoise(const EvaluationContext& context); // Empty if cancelled
 
     // m_OutputImage is inherited from Node base class
     void* m_PreviewTexture = nullptr; // Use void* for texture handle
-    bool m_ShowPreview = true; // Added for optional preview
 
     // Noise parameters
-    int m_Width = 256;
-    int m_Height = 256;
-    int m_NoiseType = 0; // 0: Uniform Random, 1: Gaussian Random (Future: Perlin, Simplex, Worley)
-    float m_Scale = 1.0f; // General scale factor
-    bool m_IsColor = false; // Generate color or grayscale noise
+    struct Parameters {
+        int Width = 256;
+        int Height = 256;
+        int NoiseType = 0; // 0: Uniform Random, 1: Gaussian Random (Future: Perlin, Simplex, Worley)
+        float Scale = 1.0f; // General scale factor
+        bool IsColor = false; // Generate color or grayscale noise
 
-    // Parameters for specific noise types (example for Gaussian)
-    double m_Mean = 128.0;
-    double m_StdDev = 50.0;
+        // Parameters for specific noise types (example for Gaussian)
+        double Mean = 128.0;
+        double StdDev = 50.0;
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
 };
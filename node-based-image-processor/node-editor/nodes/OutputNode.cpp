@@ -1,7 +1,9 @@
 #include "OutputNode.h"
 #include "../ImageDataManager.h"
+#include "../NodeEditorManager.h"
 #include <imgui.h>
 #include <filesystem>
+#include <algorithm>
 #include <../../ImageEditorApp.h>
 
 // Windows headers for file dialog
@@ -21,7 +23,7 @@ OutputNode::~OutputNode()
     CleanupTexture();
 }
 
-void OutputNode::Process()
+void OutputNode::Process(const EvaluationContext& context)
 {
     // Get the image from the connected input node using ImageDataManager
     if (!Inputs.empty())
@@ -33,29 +35,79 @@ void OutputNode::Process()
         m_InputImage = cv::Mat();
     }
     
-    // Generate a preview image (possibly scaled down)
+    // Keep the image to save and preview (possibly scaled down by PreparePreview)
     if (!m_InputImage.empty())
     {
-        m_PreviewImage = m_InputImage.clone();
+        m_OutputImage = m_InputImage; // Shares the buffer, published images are immutable
         
-        // Update the preview texture
-        UpdatePreviewTexture();
+        // The input was computed in full (its producer can't compute just a region), crop it here
+        cv::Rect region;
+        if (GetRequestedRegion(m_InputImage.size(), region))
+            m_OutputImage = m_InputImage(region);
     }
 }
 
+void OutputNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+bool OutputNode::RequestsRegion() const
+{
+    return m_ProcessParams.InspectRegion;
+}
+
+bool OutputNode::GetRequestedRegion(const cv::Size& inputSize, cv::Rect& region) const
+{
+    if (!m_ProcessParams.InspectRegion || inputSize.area() == 0)
+        return false;
+    
+    int width = std::min<int>(m_ProcessParams.RegionSize, inputSize.width);
+    int height = std::min<int>(m_ProcessParams.RegionSize, inputSize.height);
+    int x = cvRound(m_ProcessParams.CenterX * inputSize.width) - width / 2;
+    int y = cvRound(m_ProcessParams.CenterY * inputSize.height) - height / 2;
+    region = cv::Rect(std::clamp(x, 0, inputSize.width - width), std::clamp(y, 0, inputSize.height - height), width, height);
+    return true;
+}
+
+void OutputNode::SetRegionResult(const cv::Mat& region)
+{
+    m_InputImage = region;
+    m_OutputImage = region;
+}
+
+bool OutputNode::IsGraphOutput() const
+{
+    // Whatever feeds an output node is evaluated, on screen or not: it is what gets saved
+    return true;
+}
+
+void OutputNode::GetHeldImages(std::vector<cv::Mat>& images) const
+{
+    // The input is kept, it is what gets saved
+    Node::GetHeldImages(images);
+    images.push_back(m_InputImage);
+}
+
+void OutputNode::UpdatePreview()
+{
+    // Re-create the preview texture from the latest preview image
+    UpdatePreviewTexture();
+}
+
 void OutputNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
 
     // Display image preview if we have one
-    if (!m_PreviewImage.empty() && m_PreviewTexture)
+    if (!m_DisplayImage.empty() && m_PreviewTexture)
     {
         // Calculate preview size
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
         
-        float aspectRatio = (float)m_PreviewImage.cols / (float)m_PreviewImage.rows;
-        float previewWidth = std::min<int>(maxPreviewWidth, (float)m_PreviewImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min<int>(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
         
         if (previewHeight > maxPreviewHeight)
@@ -68,11 +120,33 @@ void OutputNode::DrawNodeContent()
         ImGui::Image(m_PreviewTexture, ImVec2(previewWidth, previewHeight));
         
         // Display image info
-        ImGui::Text("Size: %d x %d", m_PreviewImage.cols, m_PreviewImage.rows);
-        ImGui::Text("Channels: %d", m_PreviewImage.channels());
+        ImGui::Text("Size: %d x %d", m_DisplayImage.cols, m_DisplayImage.rows);
+        ImGui::Text("Channels: %d", m_DisplayImage.channels());
         
         const float itemWidth = 150.0f; // Define a width for the widgets
 
+        // 1:1 inspection: only the region shown here is computed by the nodes feeding it
+        bool changed = ImGui::Checkbox("Inspect at 1:1", &m_Params.InspectRegion);
+        if (m_Params.InspectRegion)
+        {
+            ImGui::PushItemWidth(itemWidth);
+            changed |= ImGui::SliderFloat("Center X", &m_Params.CenterX, 0.0f, 1.0f, "%.3f");
+            changed |= ImGui::SliderFloat("Center Y", &m_Params.CenterY, 0.0f, 1.0f, "%.3f");
+            const int regionSizes[] = { 256, 512, 1024 };
+            const char* regionSizeNames[] = { "256 px", "512 px", "1024 px" };
+            int sizeIndex = m_Params.RegionSize <= 256 ? 0 : (m_Params.RegionSize <= 512 ? 1 : 2);
+            if (ImGui::Combo("Region", &sizeIndex, regionSizeNames, 3))
+            {
+                m_Params.RegionSize = regionSizes[sizeIndex];
+                changed = true;
+            }
+            ImGui::PopItemWidth();
+        }
+        if (changed)
+        {
+            SetDirty(true);
+        }
+
         // Output format selection
         ImGui::PushItemWidth(itemWidth);
         const char* formats[] = { "JPEG", "PNG", "BMP" };
@@ -113,18 +187,26 @@ void OutputNode::DrawNodeContent()
             auto currentTime = std::time(nullptr);
             if (currentTime - m_SaveTimestamp < feedbackDuration)
             {
-                // Extract filename without using std::filesystem
-                std::string filename = m_LastSavePath;
-                size_t lastSlash = filename.find_last_of("/\\");
+                // Extract filename without using std::filesystem, or a copy every frame
+                const char* filename = m_LastSavePath.c_str();
+                size_t lastSlash = m_LastSavePath.find_last_of("/\\");
                 if (lastSlash != std::string::npos)
-                    filename = filename.substr(lastSlash + 1);
+                    filename += lastSlash + 1;
                 
-                ImGui::TextColored(ImVec4(0.0f, 0.8f, 0.0f, 1.0f), "Saved: %s", filename.c_str());
+                ImGui::TextColored(ImVec4(0.0f, 0.8f, 0.0f, 1.0f), "Saved: %s", filename);
             }
         }
         
-        // Save button
-        if (ImGui::Button("Save Image"))
+        // Save button, only for the whole image at full resolution
+        if (m_ProcessParams.InspectRegion)
+        {
+            ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Turn off 1:1 inspection to save");
+        }
+        else if (g_NodeEditorManager && g_NodeEditorManager->GetEvaluationStats().ProxyScale < 1.0)
+        {
+            ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Refining to full resolution...");
+        }
+        else if (ImGui::Button("Save Image"))
         {
             ShowSaveFileDialog();
         }
@@ -139,7 +221,7 @@ void OutputNode::DrawNodeContent()
 
 bool OutputNode::SaveImage(const std::string& path)
 {
-    if (m_InputImage.empty())
+    if (m_DisplayImage.empty())
         return false;
     
     std::vector<int> params;
@@ -157,7 +239,7 @@ bool OutputNode::SaveImage(const std::string& path)
     }
     
     // Try to save the image
-    bool success = cv::imwrite(path, m_InputImage, params);
+    bool success = cv::imwrite(path, m_DisplayImage, params);
     
     // Store result info for feedback
     m_SaveSuccess = success;
@@ -171,7 +253,7 @@ bool OutputNode::SaveImage(const std::string& path)
 
 bool OutputNode::ShowSaveFileDialog()
 {
-    if (m_InputImage.empty())
+    if (m_DisplayImage.empty())
         return false;
 
     // Set default file extension based on selected format
@@ -227,34 +309,14 @@ void OutputNode::UpdatePreviewTexture()
     // Clean up any existing texture
     CleanupTexture();
     
+    // The RGBA preview was already prepared on the evaluation thread
     if (m_PreviewImage.empty())
         return;
     
-    // Verify we have valid image data
-    if (m_PreviewImage.data == nullptr)
-        return;
-    
-    // Convert image from OpenCV BGR format to RGBA for texture creation
-    cv::Mat rgbImage;
-    try {
-        if (m_PreviewImage.channels() == 3)
-            cv::cvtColor(m_PreviewImage, rgbImage, cv::COLOR_BGR2RGBA);
-        else if (m_PreviewImage.channels() == 4)
-            cv::cvtColor(m_PreviewImage, rgbImage, cv::COLOR_BGRA2RGBA);
-        else if (m_PreviewImage.channels() == 1)
-            cv::cvtColor(m_PreviewImage, rgbImage, cv::COLOR_GRAY2RGBA);
-        else
-            rgbImage = m_PreviewImage.clone(); // Just use as-is if format is unexpected
-    }
-    catch (const cv::Exception&) {
-        // Handle conversion error - just return without creating texture
-        return;
-    }
-    
     try {
         // Use the Application's texture creation API
         if (ImageEditorApp* app = ImageEditorApp::GetInstance()) {
-            m_PreviewTexture = app->CreateTexture(rgbImage.data, rgbImage.cols, rgbImage.rows);
+            m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
         }
     }
     catch (...) {
@@ -9,8 +9,15 @@ public:
     ~OutputNode() override;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void UpdatePreview() override;
+    void CaptureParameters() override;
+    bool RequestsRegion() const override;
+    bool GetRequestedRegion(const cv::Size& inputSize, cv::Rect& region) const override;
+    void SetRegionResult(const cv::Mat& region) override;
+    bool IsGraphOutput() const override;
+    void GetHeldImages(std::vector<cv::Mat>& images) const override;
     
     // Save functionality
     bool SaveImage(const std::string& path);
@@ -18,9 +25,18 @@ public:
     
 private:
     cv::Mat m_InputImage;
-    cv::Mat m_PreviewImage;
     ImTextureID m_PreviewTexture = nullptr;
     
+    // 1:1 inspection of part of the image. Only that region is computed upstream.
+    struct Parameters {
+        bool InspectRegion = false;
+        float CenterX = 0.5f;     // Center of the region, relative to the image size
+        float CenterY = 0.5f;
+        int RegionSize = 512;     // Side of the region in pixels
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
+    
     // Save settings
     int m_OutputFormat = 0; // 0 = JPG, 1 = PNG, 2 = BMP
     int m_JpegQuality = 95;
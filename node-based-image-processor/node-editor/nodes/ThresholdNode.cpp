@@ -19,7 +19,7 @@ ThresholdNode::ThresholdNode(int id)
     m_Histogram = cv::Mat::zeros(100, 256, CV_8UC3);
 }
 
-void ThresholdNode::Process()
+void ThresholdNode::Process(const EvaluationContext& context)
 {
     // Get input image from the ImageDataManager
     if (!Inputs.empty())
@@ -35,26 +35,75 @@ void ThresholdNode::Process()
     {
         // No input image, clear output
         m_OutputImage = cv::Mat();
-        CleanupTextures();
         return;
     }
     
+    // Convert to grayscale once, band by band; the histogram and the threshold both use it
+    cv::Mat grayImage;
+    if (m_InputImage.channels() == 1)
+    {
+        grayImage = m_InputImage; // Read-only use, no copy needed
+    }
+    else
+    {
+        grayImage.create(m_InputImage.size(), CV_8UC1);
+        bool completed = context.ForEachRowBand(m_InputImage.rows, [&](const cv::Range& rows)
+        {
+            cv::Mat grayBand = grayImage.rowRange(rows);
+            cv::cvtColor(m_InputImage.rowRange(rows), grayBand, cv::COLOR_BGR2GRAY);
+        });
+        if (!completed)
+            return;
+    }
+    
     // Update histogram
-    UpdateHistogram();
+    UpdateHistogram(grayImage);
     
     // Apply threshold
-    m_OutputImage = ApplyThreshold(m_InputImage);
+    cv::Mat result = ApplyThreshold(grayImage, m_InputImage.channels() > 1, context);
+    if (result.empty())
+        return; // Cancelled
+    m_OutputImage = result;
     
     // Set the output image in the ImageDataManager
     if (!m_OutputImage.empty() && !Outputs.empty())
     {
         ImageDataManager::GetInstance().SetImageData(Outputs[0].ID, m_OutputImage);
     }
-    
-    // Update the preview texture
+}
+
+void ThresholdNode::CaptureParameters()
+{
+    m_ProcessParams = m_Params;
+}
+
+void ThresholdNode::ScaleParameters(double scale)
+{
+    // The adaptive neighborhood is in pixels and must stay odd
+    m_ProcessParams.AdaptiveBlockSize = std::max(3, cvRound(m_Params.AdaptiveBlockSize * scale) | 1);
+}
+
+void ThresholdNode::UpdatePreview()
+{
+    m_DisplayedOtsuThreshold = m_OtsuThreshold;
+
+    // Without an output there is nothing to show, drop both textures
+    if (m_OutputImage.empty())
+    {
+        CleanupTextures();
+        return;
+    }
+
+    UpdateHistogramTexture();
     UpdatePreviewTexture();
 }
 
+void ThresholdNode::ReleaseInputs()
+{
+    // The histogram stays, it was computed from the input already
+    m_InputImage.release();
+}
+
 void ThresholdNode::DrawNodeContent()
 {
     ImGui::PushID(ID.AsPointer()); // Ensure unique IDs for widgets within this node instance
@@ -66,55 +115,55 @@ void ThresholdNode::DrawNodeContent()
     // Select threshold type
     ImGui::PushItemWidth(itemWidth);
     const char* thresholdTypes[] = { "Binary", "Adaptive", "Otsu" };
-    changed |= ImGui::Combo("Threshold Type", &m_ThresholdType, thresholdTypes, 3);
+    changed |= ImGui::Combo("Threshold Type", &m_Params.ThresholdType, thresholdTypes, 3);
     ImGui::PopItemWidth();
 
     // Show parameters based on selected type
     ImGui::PushItemWidth(itemWidth);
-    if (m_ThresholdType == 0) // Binary threshold
+    if (m_Params.ThresholdType == 0) // Binary threshold
     {
-        float threshValue = static_cast<float>(m_ThresholdValue);
+        float threshValue = static_cast<float>(m_Params.ThresholdValue);
         if (ImGui::SliderFloat("Threshold Value", &threshValue, 0.0f, 255.0f))
         {
-            m_ThresholdValue = static_cast<double>(threshValue);
+            m_Params.ThresholdValue = static_cast<double>(threshValue);
             changed = true;
         }
     }
-    else if (m_ThresholdType == 1) // Adaptive threshold
+    else if (m_Params.ThresholdType == 1) // Adaptive threshold
     {
         // Block size must be odd and >= 3
-        changed |= ImGui::SliderInt("Block Size", &m_AdaptiveBlockSize, 3, 99);
-        if (m_AdaptiveBlockSize % 2 == 0)
-            m_AdaptiveBlockSize++; // Make sure it's odd
+        changed |= ImGui::SliderInt("Block Size", &m_Params.AdaptiveBlockSize, 3, 99);
+        if (m_Params.AdaptiveBlockSize % 2 == 0)
+            m_Params.AdaptiveBlockSize++; // Make sure it's odd
 
-        float constant = static_cast<float>(m_AdaptiveConstant);
+        float constant = static_cast<float>(m_Params.AdaptiveConstant);
         if (ImGui::SliderFloat("C Value", &constant, -10.0f, 10.0f))
         {
-            m_AdaptiveConstant = static_cast<double>(constant);
+            m_Params.AdaptiveConstant = static_cast<double>(constant);
             changed = true;
         }
     }
     ImGui::PopItemWidth(); // Pop item width after parameter widgets
 
     // Invert option
-    changed |= ImGui::Checkbox("Invert Result", &m_InvertThreshold);
+    changed |= ImGui::Checkbox("Invert Result", &m_Params.InvertThreshold);
     
     // Mark node as dirty if any parameter changed
     if (changed)
     {
-        Dirty = true;
+        SetDirty(true);
     }
     
     // Display histogram if available
-    if (!m_Histogram.empty() && m_HistogramTexture)
+    if (m_HistogramTexture)
     {
         ImGui::Text("Histogram:");
         ImGui::Image(m_HistogramTexture, ImVec2(256, 100));
         
         // Draw threshold line on histogram for binary mode
-        if (m_ThresholdType == 0 || m_ThresholdType == 2)
+        if (m_Params.ThresholdType == 0 || m_Params.ThresholdType == 2)
         {
-            float threshold = (m_ThresholdType == 0) ? (float)m_ThresholdValue : (float)cv::threshold(m_InputImage, cv::Mat(), 0, 255, cv::THRESH_OTSU);
+            float threshold = (m_Params.ThresholdType == 0) ? (float)m_Params.ThresholdValue : (float)m_DisplayedOtsuThreshold;
             ImVec2 cursorPos = ImGui::GetCursorScreenPos();
             cursorPos.y -= 100; // Move up to histogram position
             
@@ -126,10 +175,10 @@ void ThresholdNode::DrawNodeContent()
     }
 
     // Add checkbox for preview
-    ImGui::Checkbox("Show Preview", &m_ShowPreview);
+    DrawPreviewCheckbox();
 
     // Display preview if enabled and we have an output image
-    if (m_ShowPreview && !m_OutputImage.empty() && m_PreviewTexture)
+    if (m_ShowPreview && !m_DisplayImage.empty() && m_PreviewTexture)
     {
         ImGui::Separator();
         ImGui::Text("Preview:");
@@ -138,8 +187,8 @@ void ThresholdNode::DrawNodeContent()
         const float maxPreviewWidth = 200.0f;
         const float maxPreviewHeight = 150.0f;
         
-        float aspectRatio = (float)m_OutputImage.cols / (float)m_OutputImage.rows;
-        float previewWidth = std::min(maxPreviewWidth, (float)m_OutputImage.cols);
+        float aspectRatio = (float)m_DisplayImage.cols / (float)m_DisplayImage.rows;
+        float previewWidth = std::min(maxPreviewWidth, (float)m_DisplayImage.cols);
         float previewHeight = previewWidth / aspectRatio;
         
         if (previewHeight > maxPreviewHeight)
@@ -159,57 +208,135 @@ void ThresholdNode::DrawNodeContent()
     ImGui::PopID(); // Pop the node instance ID
 }
 
-cv::Mat ThresholdNode::ApplyThreshold(const cv::Mat& inputImage)
+cv::Mat ThresholdNode::ApplyThreshold(const cv::Mat& grayImage, bool colorOutput, const EvaluationContext& context)
 {
-    cv::Mat result;
-    cv::Mat grayImage;
+    const Parameters& params = m_ProcessParams;
+    const int thresholdType = params.InvertThreshold ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
     
-    // Convert to grayscale if needed
-    if (inputImage.channels() == 1)
-        grayImage = inputImage.clone();
-    else
-        cv::cvtColor(inputImage, grayImage, cv::COLOR_BGR2GRAY);
+    // If input was color, convert result back to color for consistent output
+    cv::Mat result(grayImage.size(), colorOutput ? CV_8UC3 : CV_8UC1);
+    auto storeBand = [&](const cv::Range& rows, const cv::Mat& mask)
+    {
+        cv::Mat resultBand = result.rowRange(rows);
+        if (colorOutput)
+            cv::cvtColor(mask, resultBand, cv::COLOR_GRAY2BGR);
+        else
+            mask.copyTo(resultBand);
+    };
     
-    // Apply thresholding based on selected type
-    if (m_ThresholdType == 0) // Binary
+    // Apply thresholding based on selected type. Binary thresholding is pointwise and
+    // runs band by band; adaptive and Otsu need the whole image, so they can only be
+    // cancelled before they start.
+    cv::Mat mask;
+    if (params.ThresholdType == 0) // Binary
     {
-        int thresholdType = m_InvertThreshold ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
-        cv::threshold(grayImage, result, m_ThresholdValue, 255, thresholdType);
+        bool completed = context.ForEachRowBand(grayImage.rows, [&](const cv::Range& rows)
+        {
+            cv::threshold(grayImage.rowRange(rows), mask, params.ThresholdValue, 255, thresholdType);
+            storeBand(rows, mask);
+        });
+        return completed ? result : cv::Mat();
     }
-    else if (m_ThresholdType == 1) // Adaptive
+    
+    if (context.IsCancelled())
+        return cv::Mat();
+    
+    if (params.ThresholdType == 1) // Adaptive
     {
         int adaptiveMethod = cv::ADAPTIVE_THRESH_GAUSSIAN_C;
-        int thresholdType = m_InvertThreshold ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
-        cv::adaptiveThreshold(grayImage, result, 255, adaptiveMethod, thresholdType, m_AdaptiveBlockSize, m_AdaptiveConstant);
+        cv::adaptiveThreshold(grayImage, mask, 255, adaptiveMethod, thresholdType, params.AdaptiveBlockSize, params.AdaptiveConstant);
     }
-    else if (m_ThresholdType == 2) // Otsu
+    else if (params.ThresholdType == 2) // Otsu
     {
-        int thresholdType = m_InvertThreshold ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
-        cv::threshold(grayImage, result, 0, 255, thresholdType | cv::THRESH_OTSU);
+        m_OtsuThreshold = cv::threshold(grayImage, mask, 0, 255, thresholdType | cv::THRESH_OTSU);
     }
     
-    // If input was color, convert result back to color for consistent output
-    if (inputImage.channels() > 1)
+    bool completed = context.ForEachRowBand(grayImage.rows, [&](const cv::Range& rows)
     {
-        cv::Mat colorResult;
-        cv::cvtColor(result, colorResult, cv::COLOR_GRAY2BGR);
-        return colorResult;
+        storeBand(rows, mask.rowRange(rows));
+    });
+    return completed ? result : cv::Mat();
+}
+
+int ThresholdNode::GetInputHalo() const
+{
+    // Binary thresholding is pointwise, adaptive and Otsu need the whole image
+    return m_ProcessParams.ThresholdType == 0 ? 0 : -1;
+}
+
+bool ThresholdNode::GetParameterHash(size_t& hash) const
+{
+    hash = 0;
+    HashCombine(hash, m_ProcessParams.ThresholdType);
+    HashCombine(hash, m_ProcessParams.ThresholdValue);
+    HashCombine(hash, m_ProcessParams.AdaptiveBlockSize);
+    HashCombine(hash, m_ProcessParams.AdaptiveConstant);
+    HashCombine(hash, m_ProcessParams.InvertThreshold);
+    return true;
+}
+
+void ThresholdNode::SaveResults(NodeResults& results) const
+{
+    Node::SaveResults(results);
+
+    // The histogram and the Otsu threshold belong to the results too. The input is only
+    // read by Process(), caching it would double the size of every entry.
+    results.Extra = { m_Histogram };
+    results.Values = { m_OtsuThreshold };
+}
+
+void ThresholdNode::LoadResults(const NodeResults& results)
+{
+    Node::LoadResults(results);
+
+    // Whatever input the node kept is not the one these results were computed from
+    m_InputImage.release();
+    if (results.Extra.size() == 1 && results.Values.size() == 1)
+    {
+        m_Histogram = results.Extra[0];
+        m_OtsuThreshold = results.Values[0];
     }
+}
+
+void ThresholdNode::ProcessTile(const cv::Mat& input, cv::Mat& output) const
+{
+    const int thresholdType = m_ProcessParams.InvertThreshold ? cv::THRESH_BINARY_INV : cv::THRESH_BINARY;
+    
+    cv::Mat grayTile;
+    if (input.channels() == 1)
+        grayTile = input;
+    else
+        cv::cvtColor(input, grayTile, cv::COLOR_BGR2GRAY);
     
-    return result;
+    cv::Mat mask;
+    cv::threshold(grayTile, mask, m_ProcessParams.ThresholdValue, 255, thresholdType);
+    if (input.channels() > 1)
+        cv::cvtColor(mask, output, cv::COLOR_GRAY2BGR);
+    else
+        mask.copyTo(output);
 }
 
-void ThresholdNode::UpdateHistogram()
+void ThresholdNode::SetTiledResult(const cv::Mat& input, const cv::Mat& output)
 {
-    if (m_InputImage.empty())
-        return;
+    Node::SetTiledResult(input, output);
     
-    // Create grayscale image if needed
+    // The histogram shows the whole input, not a tile. A streamed or fused input never exists
+    // as a whole, the histogram then keeps showing the last one.
+    m_InputImage = input;
+    if (input.empty())
+        return;
     cv::Mat grayImage;
-    if (m_InputImage.channels() == 1)
-        grayImage = m_InputImage.clone();
+    if (input.channels() == 1)
+        grayImage = input;
     else
-        cv::cvtColor(m_InputImage, grayImage, cv::COLOR_BGR2GRAY);
+        cv::cvtColor(input, grayImage, cv::COLOR_BGR2GRAY);
+    UpdateHistogram(grayImage);
+}
+
+void ThresholdNode::UpdateHistogram(const cv::Mat& grayImage)
+{
+    if (grayImage.empty())
+        return;
     
     // Calculate histogram
     int histSize = 256;
@@ -234,8 +361,10 @@ void ThresholdNode::UpdateHistogram()
             cv::FILLED
         );
     }
-    
-    // Update histogram texture
+}
+
+void ThresholdNode::UpdateHistogramTexture()
+{
     // Get app instance
     ImageEditorApp* app = ImageEditorApp::GetInstance();
     
@@ -264,29 +393,14 @@ void ThresholdNode::UpdatePreviewTexture()
         m_PreviewTexture = nullptr;
     }
 
-    // Use the local output image
-    if (m_OutputImage.empty())
+    // The RGBA preview was already prepared on the evaluation thread
+    if (m_PreviewImage.empty())
         return;
 
-    // Verify we have valid image data
-    if (m_OutputImage.data == nullptr)
-        return;
-
-    // Convert image from OpenCV BGR format to RGB for OpenGL
-    cv::Mat rgbImage;
-    if (m_OutputImage.channels() == 3)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGR2RGBA);
-    else if (m_OutputImage.channels() == 4)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_BGRA2RGBA);
-    else if (m_OutputImage.channels() == 1)
-        cv::cvtColor(m_OutputImage, rgbImage, cv::COLOR_GRAY2RGBA);
-    else
-        rgbImage = m_OutputImage.clone(); // Just use as-is if format is unexpected
-
     // Use ImageEditorApp singleton to create texture instead of direct OpenGL calls
     if (ImageEditorApp* app = ImageEditorApp::GetInstance())
     {
-        m_PreviewTexture = app->CreateTexture(rgbImage.data, rgbImage.cols, rgbImage.rows);
+        m_PreviewTexture = app->CreateTexture(m_PreviewImage.data, m_PreviewImage.cols, m_PreviewImage.rows);
     }
 }
 
@@ -8,27 +8,43 @@ public:
     ~ThresholdNode() override = default;
 
     // Node interface implementation
-    void Process() override;
+    void Process(const EvaluationContext& context) override;
     void DrawNodeContent() override;
+    void CaptureParameters() override;
+    void ScaleParameters(double scale) override;
+    int GetInputHalo() const override;
+    bool GetParameterHash(size_t& hash) const override;
+    void SaveResults(NodeResults& results) const override;
+    void LoadResults(const NodeResults& results) override;
+    void ProcessTile(const cv::Mat& input, cv::Mat& output) const override;
+    void SetTiledResult(const cv::Mat& input, const cv::Mat& output) override;
+    void UpdatePreview() override;
+    void ReleaseInputs() override;
 
 private:
     // Input/Output images
     cv::Mat m_InputImage;
     cv::Mat m_Histogram;
+    double m_OtsuThreshold = 0;          // Threshold picked by Otsu's method in Process()
+    double m_DisplayedOtsuThreshold = 0; // Value of the last completed evaluation, for the UI
     ImTextureID m_PreviewTexture = nullptr;
     ImTextureID m_HistogramTexture = nullptr;
     
     // Thresholding parameters
-    int m_ThresholdType = 0;      // 0: Binary, 1: Adaptive, 2: Otsu
-    double m_ThresholdValue = 128;  // For binary threshold (0-255)
-    int m_AdaptiveBlockSize = 11;   // For adaptive threshold (odd values 3-99)
-    double m_AdaptiveConstant = 2;  // For adaptive threshold
-    bool m_InvertThreshold = false; // Invert the threshold result
-    bool m_ShowPreview = true; // Added for optional preview
+    struct Parameters {
+        int ThresholdType = 0;      // 0: Binary, 1: Adaptive, 2: Otsu
+        double ThresholdValue = 128;  // For binary threshold (0-255)
+        int AdaptiveBlockSize = 11;   // For adaptive threshold (odd values 3-99)
+        double AdaptiveConstant = 2;  // For adaptive threshold
+        bool InvertThreshold = false; // Invert the threshold result
+    };
+    Parameters m_Params;          // Edited by the UI
+    Parameters m_ProcessParams;   // Snapshot used by Process()
 
     // Helper methods
     void UpdatePreviewTexture();
     void CleanupTextures();
-    void UpdateHistogram();
-    cv::Mat ApplyThreshold(const cv::Mat& inputImage);
+    void UpdateHistogram(const cv::Mat& grayImage);
+    void UpdateHistogramTexture();
+    cv::Mat ApplyThreshold(const cv::Mat& grayImage, bool colorOutput, const EvaluationContext& context); // Empty if cancelled
 };
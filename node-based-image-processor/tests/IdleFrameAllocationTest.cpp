@@ -0,0 +1,112 @@
+// Builds a large graph, lets it evaluate, then checks that frames without edits do
+// not touch the heap (see AllocationCounter). Runs headless: ImGui draws into its
+// own buffers and nothing is presented, there is no ImageEditorApp instance.
+#include "node-editor/AllocationCounter.h"
+#include "node-editor/BufferPool.h"
+#include "node-editor/NodeEditorManager.h"
+#include "node-editor/Node.h"
+#include <imgui.h>
+#include <cstdio>
+
+namespace
+{
+    // Node types of NodeFactory::CreateNode
+    const int OutputNodeType = 1;
+    const int BrightnessContrastNodeType = 2;
+    const int NoiseGenerationNodeType = 9;
+
+    const int Chains = 10;
+    const int ChainLength = 48; // Brightness/contrast nodes between a noise and an output node
+    const int MaxWarmUpFrames = 10000;
+    const int SettleFrames = 10;
+    const int IdleFrames = 100;
+
+    void RunFrame(NodeEditorManager& editor)
+    {
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0, 0));
+        ImGui::SetNextWindowSize(ImGui::GetIO().DisplaySize);
+        ImGui::Begin("Editor", nullptr, ImGuiWindowFlags_NoDecoration);
+        editor.Render();
+        ImGui::End();
+        editor.ProcessNodes();
+        ImGui::Render();
+    }
+
+    bool BuildGraph(NodeEditorManager& editor)
+    {
+        for (int chain = 0; chain < Chains; ++chain)
+        {
+            const float y = chain * 300.0f;
+            Node* previous = editor.CreateNode(NoiseGenerationNodeType, ImVec2(0, y));
+            if (!previous)
+                return false;
+            for (int i = 0; i < ChainLength; ++i)
+            {
+                Node* node = editor.CreateNode(BrightnessContrastNodeType, ImVec2((i + 1) * 250.0f, y));
+                if (!node || !editor.CreateLink(&previous->Outputs[0], &node->Inputs[0]))
+                    return false;
+                previous = node;
+            }
+            Node* output = editor.CreateNode(OutputNodeType, ImVec2((ChainLength + 1) * 250.0f, y));
+            if (!output || !editor.CreateLink(&previous->Outputs[0], &output->Inputs[0]))
+                return false;
+        }
+        return true;
+    }
+}
+
+int main()
+{
+    ImGui::CreateContext();
+    AllocationCounter::InstallImGuiHooks();
+    ImGuiIO& io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1280, 720);
+    io.DeltaTime = 1.0f / 60.0f;
+    unsigned char* pixels = nullptr;
+    int width = 0, height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    BufferPool::GetInstance().Install();
+    int result = 0;
+    {
+        NodeEditorManager editor;
+        editor.Initialize();
+        if (!BuildGraph(editor))
+        {
+            std::printf("Failed to build the graph\n");
+            result = 1;
+        }
+        else
+        {
+            // The first frames lay the nodes out and evaluate them
+            int frame = 0;
+            do
+                RunFrame(editor);
+            while (++frame < MaxWarmUpFrames && (frame < SettleFrames || editor.IsEvaluating()));
+            for (int i = 0; i < SettleFrames; ++i)
+                RunFrame(editor);
+
+            if (editor.IsEvaluating())
+            {
+                std::printf("Evaluation did not finish after %d frames\n", frame);
+                result = 1;
+            }
+            else
+            {
+                const uint64_t before = AllocationCounter::GetAllocations();
+                for (int i = 0; i < IdleFrames; ++i)
+                    RunFrame(editor);
+                const uint64_t allocations = AllocationCounter::GetAllocations() - before;
+
+                std::printf("%d nodes, %llu heap allocations in %d idle frames\n", Chains * (ChainLength + 2),
+                    (unsigned long long)allocations, IdleFrames);
+                if (allocations != 0)
+                    result = 1;
+            }
+        }
+    }
+    ImGui::DestroyContext();
+    return result;
+}